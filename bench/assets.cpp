@@ -0,0 +1,443 @@
+// Measures ResourceManager on generated assets: textures of several sizes,
+// decoded and cooked, copies of a font, music and sounds in OGG and FLAC,
+// and scenes with many widgets. Every asset is loaded cold, by a fresh
+// manager, and warm, from its cache. Results, the cache hit rate and the
+// peak memory are printed as JSON. Given a baseline printed by an earlier
+// run, timings slower than it by more than the tolerance are listed as
+// regressions and the exit code is 1.
+//
+// Textures need an OpenGL context: on Linux without a display, run it
+// under a virtual X server such as xvfb-run.
+//
+// usage: sakura-bench-assets [--textures <size>,...] [--widgets <count>,...]
+//                            [--audio <seconds>] [--reps <count>]
+//                            [--baseline <file>] [--tolerance <percent>]
+//                            <font file>
+
+#include "../sakura/content_hash.h"
+#include "../sakura/cooked_texture.h"
+#include "../sakura/resource_manager.h"
+#include "../sakura/utility.h"
+#include "bench_util.h"
+#include <SFML/Audio.hpp>
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// copies of the font loaded by one manager, all but the first deduplicated
+constexpr std::size_t FONT_COPIES = 4;
+// loads averaged for a warm timing
+constexpr std::size_t WARM_LOADS = 1000;
+constexpr unsigned SAMPLE_RATE = 44100;
+
+struct Context {
+  std::filesystem::path dir;
+  std::size_t reps = 3;
+  sakura::JobSystem jobs;
+  nlohmann::json results = nlohmann::json::array();
+  // summed over every manager
+  sakura::CacheStats cache;
+
+  std::unique_ptr<sakura::ResourceManager> makeManager() {
+    auto manager = std::make_unique<sakura::ResourceManager>(jobs);
+    for (auto prefix : {"texture", "music", "sound", "font", "scene"}) {
+      manager->prefixes[prefix] = dir;
+    }
+    return manager;
+  }
+
+  void collect(const sakura::ResourceManager &manager) {
+    auto &stats = manager.stats();
+    cache.hits += stats.hits;
+    cache.misses += stats.misses;
+    cache.deduplicated += stats.deduplicated;
+    cache.deduplicated_bytes += stats.deduplicated_bytes;
+    cache.unloaded += stats.unloaded;
+  }
+
+  void add(const std::string &name, const std::string &asset, double seconds) {
+    results.push_back({{"name", name}, {"asset", asset}, {"seconds", seconds}});
+  }
+};
+
+template <typename F> double timed(F &&func) {
+  auto start = Clock::now();
+  func();
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// The fastest of `reps` results of `func`, which times itself.
+template <typename F> double fastest(std::size_t reps, F &&func) {
+  double best = func();
+  for (std::size_t i = 1; i < reps; ++i) {
+    best = std::min(best, func());
+  }
+  return best;
+}
+
+// A gradient with noise, which compresses about as well as artwork.
+void makeImage(const std::filesystem::path &path, unsigned size) {
+  std::vector<std::uint8_t> pixels(std::size_t{size} * size * 4);
+  std::uint32_t seed = size;
+  for (unsigned y = 0; y < size; ++y) {
+    for (unsigned x = 0; x < size; ++x) {
+      seed = seed * 1664525u + 1013904223u;
+      auto noise = static_cast<std::uint8_t>(seed >> 28);
+      auto pixel = &pixels[(std::size_t{y} * size + x) * 4];
+      pixel[0] = static_cast<std::uint8_t>(x * 255 / size + noise);
+      pixel[1] = static_cast<std::uint8_t>(y * 255 / size + noise);
+      pixel[2] = static_cast<std::uint8_t>((x + y) * 127 / size);
+      // a soft edge, so that premultiplying alpha has work to do
+      auto edge = std::max(1u, size / 8);
+      pixel[3] = static_cast<std::uint8_t>(x < edge ? x * 255 / edge : 255);
+    }
+  }
+  sf::Image image;
+  image.create(size, size, pixels.data());
+  if (!image.saveToFile(path.string())) {
+    throw std::runtime_error(
+        fmt::format("{}: can't write image", path.string()));
+  }
+}
+
+// What sakura-cook writes for `source`.
+void cookImage(const std::filesystem::path &source) {
+  sf::Image image;
+  if (!image.loadFromFile(source.string())) {
+    throw std::runtime_error(
+        fmt::format("{}: can't read image", source.string()));
+  }
+  auto size = image.getSize();
+  std::vector<std::uint8_t> pixels(image.getPixelsPtr(),
+                                   image.getPixelsPtr() +
+                                       std::size_t{size.x} * size.y * 4);
+  sakura::premultiplyAlpha(pixels.data(), std::size_t{size.x} * size.y);
+  sakura::CookedTextureHeader header;
+  header.flags = sakura::CookedTextureHeader::PREMULTIPLIED_ALPHA;
+  header.width = size.x;
+  header.height = size.y;
+  header.source_hash = sakura::hashFile(source);
+  if (!sakura::writeCookedTexture(sakura::cookedTexturePath(source), header,
+                                  pixels.data())) {
+    throw std::runtime_error(
+        fmt::format("{}: can't write cooked texture", source.string()));
+  }
+}
+
+// A chord with some noise, in stereo.
+void makeAudio(const std::filesystem::path &path, float seconds) {
+  auto frames = static_cast<std::size_t>(seconds * SAMPLE_RATE);
+  std::vector<sf::Int16> samples(frames * 2);
+  std::uint32_t seed = 1;
+  for (std::size_t i = 0; i < frames; ++i) {
+    float t = static_cast<float>(i) / SAMPLE_RATE;
+    seed = seed * 1664525u + 1013904223u;
+    float noise = static_cast<float>(seed >> 16) / 65536.0f - 0.5f;
+    float left = std::sin(2 * 3.14159265f * 440 * t) +
+                 0.5f * std::sin(2 * 3.14159265f * 554.37f * t);
+    float right = std::sin(2 * 3.14159265f * 659.25f * t);
+    samples[i * 2] =
+        static_cast<sf::Int16>((left * 0.5f + noise * 0.05f) * 16000);
+    samples[i * 2 + 1] =
+        static_cast<sf::Int16>((right * 0.5f + noise * 0.05f) * 16000);
+  }
+  sf::SoundBuffer buffer;
+  if (!buffer.loadFromSamples(samples.data(), samples.size(), 2, SAMPLE_RATE) ||
+      !buffer.saveToFile(path.string())) {
+    throw std::runtime_error(
+        fmt::format("{}: can't write audio file", path.string()));
+  }
+}
+
+// `widgets` buttons over a few textures, with labels and actions.
+void makeScene(const std::filesystem::path &path, std::size_t widgets) {
+  auto list = nlohmann::json::array();
+  for (std::size_t i = 0; i < widgets; ++i) {
+    list.push_back({{"class", "push_button"},
+                    {"shape",
+                     {{"left", static_cast<float>(i % 20 * 64)},
+                      {"top", static_cast<float>(i / 20 % 25 * 32)},
+                      {"width", 64},
+                      {"height", 32},
+                      {"texture", fmt::format("button_{}.png", i % 4)}}},
+                    {"text", fmt::format("Button {}", i)},
+                    {"actions", {{"clicked", "entry.ela"}}}});
+  }
+  nlohmann::json scene{{"font_face", "font_0.ttf"},
+                       {"font_size", 24},
+                       {"widgets", std::move(list)}};
+  std::ofstream(path) << scene.dump();
+}
+
+void benchTextures(Context &ctx, const std::vector<unsigned> &sizes) {
+  for (auto size : sizes) {
+    auto plain = fmt::format("texture_{}.png", size);
+    auto copy = fmt::format("copy_{}.png", size);
+    auto cooked = fmt::format("cooked_{}.png", size);
+    makeImage(ctx.dir / plain, size);
+    std::filesystem::copy_file(ctx.dir / plain, ctx.dir / copy);
+    std::filesystem::copy_file(ctx.dir / plain, ctx.dir / cooked);
+    cookImage(ctx.dir / cooked);
+
+    ctx.add("texture_cold", plain, fastest(ctx.reps, [&] {
+              auto manager = ctx.makeManager();
+              auto id = manager->internTexture(plain);
+              auto seconds = timed([&] { manager->loadTexture(id); });
+              ctx.collect(*manager);
+              return seconds;
+            }));
+    ctx.add("texture_cooked_cold", cooked, fastest(ctx.reps, [&] {
+              auto manager = ctx.makeManager();
+              auto id = manager->internTexture(cooked);
+              auto seconds = timed([&] { manager->loadTexture(id); });
+              ctx.collect(*manager);
+              return seconds;
+            }));
+    // the copy is recognized by its content hash once decoded
+    ctx.add("texture_duplicate", copy, fastest(ctx.reps, [&] {
+              auto manager = ctx.makeManager();
+              auto first = manager->loadTexture(plain);
+              auto id = manager->internTexture(copy);
+              auto seconds = timed([&] { manager->loadTexture(id); });
+              ctx.collect(*manager);
+              return seconds;
+            }));
+    ctx.add("texture_warm", plain, fastest(ctx.reps, [&] {
+              auto manager = ctx.makeManager();
+              auto id = manager->internTexture(plain);
+              manager->loadTexture(id);
+              auto seconds = timed([&] {
+                for (std::size_t i = 0; i < WARM_LOADS; ++i) {
+                  manager->loadTexture(id);
+                }
+              });
+              ctx.collect(*manager);
+              return seconds / WARM_LOADS;
+            }));
+  }
+}
+
+void benchFonts(Context &ctx, const std::filesystem::path &font) {
+  for (std::size_t i = 0; i < FONT_COPIES; ++i) {
+    std::filesystem::copy_file(font, ctx.dir / fmt::format("font_{}.ttf", i));
+  }
+  ctx.add("font_cold", "font_0.ttf", fastest(ctx.reps, [&] {
+            auto manager = ctx.makeManager();
+            auto id = manager->internFont("font_0.ttf");
+            auto seconds = timed([&] { manager->loadFont(id); });
+            ctx.collect(*manager);
+            return seconds;
+          }));
+  // per copy, each is read and hashed but not parsed
+  ctx.add("font_duplicate", "font_1.ttf", fastest(ctx.reps, [&] {
+            auto manager = ctx.makeManager();
+            auto first = manager->loadFont("font_0.ttf");
+            std::vector<sakura::AssetId> ids;
+            for (std::size_t i = 1; i < FONT_COPIES; ++i) {
+              ids.push_back(manager->internFont(fmt::format("font_{}.ttf", i)));
+            }
+            auto seconds = timed([&] {
+              for (auto id : ids) {
+                manager->loadFont(id);
+              }
+            });
+            ctx.collect(*manager);
+            return seconds / ids.size();
+          }));
+  ctx.add("font_warm", "font_0.ttf", fastest(ctx.reps, [&] {
+            auto manager = ctx.makeManager();
+            auto id = manager->internFont("font_0.ttf");
+            manager->loadFont(id);
+            auto seconds = timed([&] {
+              for (std::size_t i = 0; i < WARM_LOADS; ++i) {
+                manager->loadFont(id);
+              }
+            });
+            ctx.collect(*manager);
+            return seconds / WARM_LOADS;
+          }));
+}
+
+void benchAudio(Context &ctx, float seconds) {
+  for (auto name : {"audio.ogg", "audio.flac"}) {
+    makeAudio(ctx.dir / name, seconds);
+    // music is streamed, opening it only reads the header
+    ctx.add("music_cold", name, fastest(ctx.reps, [&] {
+              auto manager = ctx.makeManager();
+              auto id = manager->internMusic(name);
+              auto elapsed = timed([&] { manager->loadMusic(id); });
+              ctx.collect(*manager);
+              return elapsed;
+            }));
+    ctx.add("music_warm", name, fastest(ctx.reps, [&] {
+              auto manager = ctx.makeManager();
+              auto id = manager->internMusic(name);
+              manager->loadMusic(id);
+              auto elapsed = timed([&] {
+                for (std::size_t i = 0; i < WARM_LOADS; ++i) {
+                  manager->loadMusic(id);
+                }
+              });
+              ctx.collect(*manager);
+              return elapsed / WARM_LOADS;
+            }));
+    // sounds are decoded whole
+    ctx.add("sound_cold", name, fastest(ctx.reps, [&] {
+              auto manager = ctx.makeManager();
+              auto id = manager->internSound(name);
+              auto elapsed = timed([&] { manager->loadSound(id); });
+              ctx.collect(*manager);
+              return elapsed;
+            }));
+    ctx.add("sound_warm", name, fastest(ctx.reps, [&] {
+              auto manager = ctx.makeManager();
+              auto id = manager->internSound(name);
+              manager->loadSound(id);
+              auto elapsed = timed([&] {
+                for (std::size_t i = 0; i < WARM_LOADS; ++i) {
+                  manager->loadSound(id);
+                }
+              });
+              ctx.collect(*manager);
+              return elapsed / WARM_LOADS;
+            }));
+  }
+}
+
+// after benchFonts, scenes use the first copy of the font
+void benchScenes(Context &ctx, const std::vector<unsigned> &widget_counts) {
+  for (unsigned i = 0; i < 4; ++i) {
+    makeImage(ctx.dir / fmt::format("button_{}.png", i), 64);
+  }
+  for (auto widgets : widget_counts) {
+    auto name = fmt::format("scene_{}.json", widgets);
+    makeScene(ctx.dir / name, widgets);
+    // compiles the config file, loads the font and textures, instantiates
+    ctx.add("scene_cold", name, fastest(ctx.reps, [&] {
+              auto manager = ctx.makeManager();
+              auto id = manager->internScene(name);
+              auto seconds = timed([&] { manager->loadScene(id); });
+              ctx.collect(*manager);
+              return seconds;
+            }));
+    // instantiates the cached prototype
+    ctx.add("scene_warm", name, fastest(ctx.reps, [&] {
+              auto manager = ctx.makeManager();
+              auto id = manager->internScene(name);
+              auto first = manager->loadScene(id);
+              auto seconds = timed([&] { manager->loadScene(id); });
+              ctx.collect(*manager);
+              return seconds;
+            }));
+  }
+}
+
+constexpr const char *USAGE =
+    "usage: sakura-bench-assets [--textures <size>,...] "
+    "[--widgets <count>,...]\n"
+    "                           [--audio <seconds>] [--reps <count>]\n"
+    "                           [--baseline <file>] [--tolerance <percent>]\n"
+    "                           <font file>\n";
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::vector<unsigned> texture_sizes{256, 1024, 2048, 4096};
+  std::vector<unsigned> widget_counts{10, 100, 1000};
+  float audio_seconds = 30;
+  std::size_t reps = 3;
+  std::filesystem::path baseline_path;
+  double tolerance = 0.1;
+  std::filesystem::path font;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--textures" && has_value) {
+      texture_sizes = sakura::bench::parseList<unsigned>(argv[++i]);
+    } else if (arg == "--widgets" && has_value) {
+      widget_counts = sakura::bench::parseList<unsigned>(argv[++i]);
+    } else if (arg == "--audio" && has_value) {
+      audio_seconds = std::strtof(argv[++i], nullptr);
+    } else if (arg == "--reps" && has_value) {
+      reps = std::max<std::size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+    } else if (arg == "--baseline" && has_value) {
+      baseline_path = argv[++i];
+    } else if (arg == "--tolerance" && has_value) {
+      tolerance = std::strtod(argv[++i], nullptr) / 100;
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      std::cerr << USAGE;
+      return -1;
+    } else {
+      font = arg;
+    }
+  }
+  if (font.empty()) {
+    std::cerr << USAGE;
+    return -1;
+  }
+  if (!std::filesystem::is_regular_file(font)) {
+    std::cerr << fmt::format("{}: no such font file\n", font.string());
+    return -1;
+  }
+
+  Context ctx;
+  ctx.dir = std::filesystem::temp_directory_path() / "sakura-bench-assets";
+  ctx.reps = reps;
+  std::filesystem::remove_all(ctx.dir);
+  std::filesystem::create_directories(ctx.dir);
+  try {
+    benchTextures(ctx, texture_sizes);
+    benchFonts(ctx, font);
+    benchAudio(ctx, audio_seconds);
+    benchScenes(ctx, widget_counts);
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << '\n';
+    std::filesystem::remove_all(ctx.dir);
+    return -1;
+  }
+  std::filesystem::remove_all(ctx.dir);
+
+  auto lookups = ctx.cache.hits + ctx.cache.misses;
+  nlohmann::json report{
+      {"results", ctx.results},
+      {"cache",
+       {{"hits", ctx.cache.hits},
+        {"misses", ctx.cache.misses},
+        {"hit_rate",
+         lookups == 0 ? 0.0 : static_cast<double>(ctx.cache.hits) / lookups},
+        {"deduplicated", ctx.cache.deduplicated},
+        {"deduplicated_bytes", ctx.cache.deduplicated_bytes}}},
+      {"peak_rss_bytes", sakura::peakResidentBytes()}};
+  bool regressed = false;
+  if (!baseline_path.empty()) {
+    std::ifstream file(baseline_path);
+    if (!file.is_open()) {
+      std::cerr << fmt::format("{}: no such baseline file\n",
+                               baseline_path.string());
+      return -1;
+    }
+    auto regressions =
+        sakura::bench::compare(ctx.results, nlohmann::json::parse(file),
+                               tolerance, "asset");
+    regressed = !regressions.empty();
+    report["regressions"] = std::move(regressions);
+  }
+  std::cout << report.dump(2) << '\n';
+  return regressed ? 1 : 0;
+}
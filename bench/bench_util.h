@@ -0,0 +1,56 @@
+#ifndef SAKURA_BENCH_BENCH_UTIL_H
+#define SAKURA_BENCH_BENCH_UTIL_H
+
+#include <cstdlib>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace sakura {
+
+namespace bench {
+
+// The comma separated unsigned integers of `list`, as given on the command
+// line.
+template <typename T> std::vector<T> parseList(const std::string &list) {
+  std::vector<T> values;
+  std::istringstream stream(list);
+  std::string value;
+  while (std::getline(stream, value, ',')) {
+    values.push_back(static_cast<T>(std::strtoull(value.c_str(), nullptr, 10)));
+  }
+  return values;
+}
+
+// Every result slower than its baseline by more than `tolerance`. A result
+// matches a baseline of the same "name" and the same value of `key`.
+inline nlohmann::json compare(const nlohmann::json &results,
+                              const nlohmann::json &baseline, double tolerance,
+                              const char *key) {
+  auto regressions = nlohmann::json::array();
+  for (auto &result : results) {
+    for (auto &base : baseline.at("results")) {
+      if (base.at("name") != result.at("name") ||
+          base.at(key) != result.at(key)) {
+        continue;
+      }
+      double before = base.at("seconds");
+      double after = result.at("seconds");
+      if (after > before * (1 + tolerance)) {
+        regressions.push_back({{"name", result.at("name")},
+                               {key, result.at(key)},
+                               {"baseline_seconds", before},
+                               {"seconds", after},
+                               {"slowdown", after / before}});
+      }
+    }
+  }
+  return regressions;
+}
+
+} // namespace bench
+
+} // namespace sakura
+
+#endif // !SAKURA_BENCH_BENCH_UTIL_H
@@ -0,0 +1,275 @@
+// Measures the Elaina pipeline on generated scripts of increasing size: lexer
+// throughput on ASCII and CJK text, parsing time and allocations, statements
+// run per second with stub commands, and the cost of loading a script cold
+// and cached. Results are printed as JSON. Given a baseline printed by an
+// earlier run, timings slower than it by more than the tolerance are listed
+// as regressions and the exit code is 1.
+//
+// usage: sakura-bench-elaina [--lines <count>,...] [--reps <count>]
+//                            [--baseline <file>] [--tolerance <percent>]
+
+#include "../sakura/elaina/lexer.h"
+#include "../sakura/elaina/parser.h"
+#include "../sakura/elaina/script_engine.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+std::atomic<std::size_t> allocations{0};
+
+} // namespace
+
+// counts every allocation, so that parsing can report how many it makes; not
+// inlined, so that the compiler doesn't pair malloc with delete
+[[gnu::noinline]] void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+[[gnu::noinline]] void operator delete(void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A script of `lines` lines mixing every kind of statement, with the text of
+// its lines in CJK if `cjk`.
+std::string makeScript(std::size_t lines, bool cjk) {
+  std::string script = "$count := 0\n";
+  for (std::size_t i = 1; i < lines; ++i) {
+    switch (i % 8) {
+    case 0:
+      script += fmt::format("; line {}\n", i);
+      break;
+    case 1:
+      script += "@bgm \"theme.ogg\"\n";
+      break;
+    case 2:
+      script += cjk ? "[伊蕾娜]\n" : "[Elaina]\n";
+      break;
+    case 3:
+      script += cjk ? fmt::format("\"这是第{}句台词，魔女之旅还在继续。\"\n", i)
+                    : fmt::format("\"This is line {}, the journey goes on.\"\n",
+                                  i);
+      break;
+    case 4:
+      script += "$count := $count + 1\n";
+      break;
+    case 5:
+      script += "@addSprite \"elaina\" \"elaina.png\" 10 20 1\n";
+      break;
+    case 6:
+      script += "$flag := ($count * 2 + 1) >= 10\n";
+      break;
+    case 7:
+      script += "@rmSprite \"elaina\"\n";
+      break;
+    }
+  }
+  return script;
+}
+
+// The fastest of `reps` runs of `func`, in seconds.
+template <typename F> double fastest(std::size_t reps, F &&func) {
+  double best = 0;
+  for (std::size_t i = 0; i < reps; ++i) {
+    auto start = Clock::now();
+    func();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    best = i == 0 ? seconds : std::min(best, seconds);
+  }
+  return best;
+}
+
+nlohmann::json benchLexer(const std::string &source, std::size_t reps) {
+  std::size_t tokens = 0;
+  auto seconds = fastest(reps, [&] {
+    std::istringstream stream(source);
+    sakura::elaina::Lexer lexer("bench.ela", stream);
+    tokens = 0;
+    while (lexer.hasNext()) {
+      lexer.next();
+      ++tokens;
+    }
+  });
+  return {{"seconds", seconds},
+          {"bytes", source.size()},
+          {"tokens", tokens},
+          {"mb_per_s", source.size() / seconds / 1e6}};
+}
+
+// lexing included, the parser pulls tokens as it goes
+nlohmann::json benchParser(const std::string &source, std::size_t lines,
+                           std::size_t reps) {
+  std::size_t count = 0;
+  std::size_t statements = 0;
+  auto seconds = fastest(reps, [&] {
+    std::istringstream stream(source);
+    sakura::elaina::Lexer lexer("bench.ela", stream);
+    sakura::elaina::Parser parser(lexer);
+    auto before = allocations.load(std::memory_order_relaxed);
+    auto script = parser.parse();
+    count = allocations.load(std::memory_order_relaxed) - before;
+    statements = script.size();
+  });
+  return {{"seconds", seconds},
+          {"statements", statements},
+          {"allocations", count},
+          {"allocations_per_line", static_cast<double>(count) / lines}};
+}
+
+void registerStubs(sakura::elaina::ScriptEngine &engine) {
+  using sakura::elaina::ScriptEngine;
+  engine.registerCommand("say", [](ScriptEngine &se) {
+    se.popText();
+    se.popText();
+  });
+  engine.registerCommand("bgm", [](ScriptEngine &se) { se.popString(); });
+  engine.registerCommand("addSprite", [](ScriptEngine &se) {
+    if (se.argc() > 4) {
+      se.popInt();
+    }
+    se.popInt();
+    se.popInt();
+    se.popString();
+    se.popString();
+  });
+  engine.registerCommand("rmSprite", [](ScriptEngine &se) { se.popString(); });
+}
+
+nlohmann::json benchRun(const std::filesystem::path &dir,
+                        const std::string &file_name, std::size_t reps) {
+  sakura::elaina::ScriptEngine engine;
+  engine.script_dir_prefix = dir;
+  registerStubs(engine);
+  engine.compile(file_name);
+  std::size_t statements = 0;
+  auto seconds = fastest(reps, [&] {
+    engine.loadScript(file_name);
+    statements = 0;
+    while (engine.runnable()) {
+      engine.run();
+      ++statements;
+    }
+  });
+  return {{"seconds", seconds},
+          {"statements", statements},
+          {"statements_per_s", statements / seconds}};
+}
+
+// reads and parses the file every time
+nlohmann::json benchLoadCold(const std::filesystem::path &dir,
+                             const std::string &file_name, std::size_t reps) {
+  auto seconds = fastest(reps, [&] {
+    sakura::elaina::ScriptEngine engine;
+    engine.script_dir_prefix = dir;
+    engine.loadScript(file_name);
+  });
+  return {{"seconds", seconds}};
+}
+
+// the script is cached, per load
+nlohmann::json benchLoadWarm(const std::filesystem::path &dir,
+                             const std::string &file_name, std::size_t reps) {
+  constexpr std::size_t LOADS = 10000;
+  sakura::elaina::ScriptEngine engine;
+  engine.script_dir_prefix = dir;
+  engine.loadScript(file_name);
+  auto seconds = fastest(reps, [&] {
+    for (std::size_t i = 0; i < LOADS; ++i) {
+      engine.loadScript(file_name);
+    }
+  });
+  return {{"seconds", seconds / LOADS}};
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::vector<std::size_t> sizes{1000, 10000, 100000};
+  std::size_t reps = 5;
+  std::filesystem::path baseline_path;
+  double tolerance = 0.1;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--lines" && has_value) {
+      sizes = sakura::bench::parseList<std::size_t>(argv[++i]);
+    } else if (arg == "--reps" && has_value) {
+      reps = std::max<std::size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+    } else if (arg == "--baseline" && has_value) {
+      baseline_path = argv[++i];
+    } else if (arg == "--tolerance" && has_value) {
+      tolerance = std::strtod(argv[++i], nullptr) / 100;
+    } else {
+      std::cerr << "usage: sakura-bench-elaina [--lines <count>,...] "
+                   "[--reps <count>]\n"
+                   "                           [--baseline <file>] "
+                   "[--tolerance <percent>]\n";
+      return -1;
+    }
+  }
+
+  // loadScript reads scripts from files
+  auto dir = std::filesystem::temp_directory_path() / "sakura-bench-elaina";
+  std::filesystem::create_directories(dir);
+
+  auto results = nlohmann::json::array();
+  auto add = [&](const char *name, std::size_t lines, nlohmann::json result) {
+    result["name"] = name;
+    result["lines"] = lines;
+    results.push_back(std::move(result));
+  };
+  for (auto lines : sizes) {
+    auto ascii = makeScript(lines, false);
+    auto cjk = makeScript(lines, true);
+    auto file_name = fmt::format("bench_{}.ela", lines);
+    std::ofstream(dir / file_name, std::ios::binary) << ascii;
+
+    add("lexer_ascii", lines, benchLexer(ascii, reps));
+    add("lexer_cjk", lines, benchLexer(cjk, reps));
+    add("parse", lines, benchParser(ascii, lines, reps));
+    add("run", lines, benchRun(dir, file_name, reps));
+    add("load_cold", lines, benchLoadCold(dir, file_name, reps));
+    add("load_warm", lines, benchLoadWarm(dir, file_name, reps));
+  }
+  std::filesystem::remove_all(dir);
+
+  nlohmann::json report{{"results", results}};
+  bool regressed = false;
+  if (!baseline_path.empty()) {
+    std::ifstream file(baseline_path);
+    if (!file.is_open()) {
+      std::cerr << fmt::format("{}: no such baseline file\n",
+                               baseline_path.string());
+      return -1;
+    }
+    auto regressions = sakura::bench::compare(
+        results, nlohmann::json::parse(file), tolerance, "lines");
+    regressed = !regressions.empty();
+    report["regressions"] = std::move(regressions);
+  }
+  std::cout << report.dump(2) << '\n';
+  return regressed ? 1 : 0;
+}
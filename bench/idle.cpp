@@ -0,0 +1,81 @@
+// Runs a project without input and reports how much CPU time it takes. A
+// project which stops on its first line measures a static screen.
+//
+// usage: sakura-bench-idle <project dir> [seconds]
+
+#include "../sakura/engine.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/core.h>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// user + system time of all threads of the process
+double processCpuSeconds() {
+#ifdef _WIN32
+  FILETIME creation, exit, kernel, user;
+  GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+  auto seconds = [](const FILETIME &time) {
+    return (static_cast<unsigned long long>(time.dwHighDateTime) << 32 |
+            time.dwLowDateTime) *
+           1e-7;
+  };
+  return seconds(kernel) + seconds(user);
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << "usage: sakura-bench-idle <project dir> [seconds]\n";
+    return -1;
+  }
+  std::filesystem::path dir = argv[1];
+  if (!std::filesystem::is_directory(dir)) {
+    std::cerr << fmt::format("{}: no such directory\n", dir.string());
+    return -1;
+  }
+  float seconds = argc == 3 ? std::strtof(argv[2], nullptr) : 10.0f;
+
+  sakura::Engine engine(dir);
+  engine.time_limit = sf::seconds(seconds);
+  auto cpu_start = processCpuSeconds();
+  auto wall_start = std::chrono::steady_clock::now();
+  engine.run();
+  auto cpu = processCpuSeconds() - cpu_start;
+  std::chrono::duration<double> wall =
+      std::chrono::steady_clock::now() - wall_start;
+
+  const auto &stats = engine.frameStats();
+  fmt::print("{{\"wall_seconds\": {:.3f}, \"cpu_seconds\": {:.3f}, "
+             "\"cpu_percent\": {:.2f}, \"iterations\": {}, \"frames\": {}, "
+             "\"idle\": {}, \"latency_ms\": {:.3f}, "
+             "\"latency_max_ms\": {:.3f}, \"interval_ms\": {:.3f}, "
+             "\"jitter_ms\": {:.3f}}}\n",
+             wall.count(), cpu, 100.0 * cpu / wall.count(), stats.iterations,
+             stats.frames, stats.idle, stats.latency_mean * 1e3,
+             stats.latency_max * 1e3, stats.interval_mean * 1e3,
+             stats.jitter * 1e3);
+  for (auto &[name, task] : engine.jobSystem().stats()) {
+    fmt::print("{{\"task\": \"{}\", \"count\": {}, \"wait_ms\": {:.3f}, "
+               "\"run_ms\": {:.3f}, \"max_run_ms\": {:.3f}}}\n",
+               name, task.count, task.wait * 1e3, task.run * 1e3,
+               task.max_run * 1e3);
+  }
+  return 0;
+}
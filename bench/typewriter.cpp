@@ -0,0 +1,143 @@
+// Measures the per-frame cost of revealing a line glyph by glyph, with
+// TypewriterText and with a sf::Text whose string grows every frame. The
+// cost of TypewriterText should not depend on the length of the line. Then
+// reports the texture memory printable ASCII takes at several character
+// sizes, in the bitmap pages of sf::Font and in the distance field atlas.
+//
+// usage: sakura-bench-typewriter <font file>
+
+#include "../sakura/sdf_font.h"
+#include "../sakura/typewriter_text.h"
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr unsigned CHARACTER_SIZE = 24;
+// frames measured at the end of the line, where the naive reveal is slowest
+constexpr std::size_t MEASURED_FRAMES = 64;
+
+std::u32string makeLine(std::size_t length) {
+  std::u32string line;
+  for (std::size_t i = 0; i < length; ++i) {
+    line += i % 8 == 7 ? U' ' : static_cast<char32_t>(U'a' + i % 26);
+  }
+  return line;
+}
+
+using Clock = std::chrono::steady_clock;
+
+double nanosecondsPerFrame(Clock::duration duration) {
+  return std::chrono::duration<double, std::nano>(duration).count() /
+         MEASURED_FRAMES;
+}
+
+// one glyph per frame, the timing starts `MEASURED_FRAMES` before the end
+double benchTypewriter(const sf::Font &font, const std::u32string &line) {
+  sakura::GlyphMetrics metrics(font, CHARACTER_SIZE);
+  sakura::TypewriterText text;
+  text.setCharacterSize(CHARACTER_SIZE);
+  text.speed = 60.0f;
+  text.fade = 4.0f;
+  text.setLayout(sakura::layoutText(metrics, line, 0.0f), metrics);
+  auto frame = sf::seconds(1.0f / 60.0f);
+  auto frames = text.glyphCount();
+  for (std::size_t i = 0; i + MEASURED_FRAMES < frames; ++i) {
+    text.update(frame);
+  }
+  auto start = Clock::now();
+  for (std::size_t i = 0; i < MEASURED_FRAMES; ++i) {
+    text.update(frame);
+  }
+  return nanosecondsPerFrame(Clock::now() - start);
+}
+
+double benchGrowingString(const sf::Font &font, const std::u32string &line) {
+  sf::Text text;
+  text.setFont(font);
+  text.setCharacterSize(CHARACTER_SIZE);
+  auto length = line.size();
+  auto first = length > MEASURED_FRAMES ? length - MEASURED_FRAMES : 0;
+  auto start = Clock::now();
+  for (auto i = first; i < first + MEASURED_FRAMES; ++i) {
+    text.setString(sf::String::fromUtf32(line.begin(),
+                                         line.begin() + std::min(i + 1, length)));
+    // forces the geometry to be rebuilt, as drawing would
+    text.getLocalBounds();
+  }
+  return nanosecondsPerFrame(Clock::now() - start);
+}
+
+const unsigned MEMORY_SIZES[] = {16, 24, 32, 48};
+
+// bytes of the pages sf::Font rasterized the glyphs into, one per size
+std::size_t bitmapPageBytes(const sf::Font &font, const std::u32string &text) {
+  std::size_t bytes = 0;
+  for (auto size : MEMORY_SIZES) {
+    for (auto c : text) {
+      font.getGlyph(c, size, false);
+    }
+    auto page = font.getTexture(size).getSize();
+    bytes += std::size_t{page.x} * page.y * 4;
+  }
+  return bytes;
+}
+
+void printTextMemory(const char *path, const sf::Font &font) {
+  std::u32string text;
+  for (char32_t c = U' '; c <= U'~'; ++c) {
+    text += c;
+  }
+  std::ifstream file(path, std::ios::binary);
+  auto bytes = std::make_shared<std::vector<char>>(
+      std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  // one atlas serves every size
+  sakura::SdfFont sdf(std::move(bytes));
+  sdf.prepare(text.data(), text.data() + text.size());
+  fmt::print("  \"text_memory\": {{\"glyphs\": {}, \"sizes\": [{}], "
+             "\"bitmap_page_bytes\": {}, \"sdf_atlas_bytes\": {}, "
+             "\"sdf_image_bytes\": {}}}\n",
+             text.size(), fmt::join(MEMORY_SIZES, ", "),
+             bitmapPageBytes(font, text), sdf.textureBytes(), sdf.imageBytes());
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    std::cerr << "usage: sakura-bench-typewriter <font file>\n";
+    return -1;
+  }
+  sf::Font font;
+  if (!font.loadFromFile(argv[1])) {
+    std::cerr << fmt::format("{}: can't load font file\n", argv[1]);
+    return -1;
+  }
+
+  fmt::print("{{\n  \"reveal\": [\n");
+  const std::size_t lengths[] = {64, 256, 1024, 4096};
+  for (std::size_t i = 0; i < std::size(lengths); ++i) {
+    auto line = makeLine(lengths[i]);
+    // rasterize every glyph first, both sides then only measure layout
+    benchTypewriter(font, line);
+    auto typewriter = benchTypewriter(font, line);
+    auto growing = benchGrowingString(font, line);
+    fmt::print("    {{\"length\": {}, \"typewriter_ns_per_frame\": {:.1f}, "
+               "\"set_string_ns_per_frame\": {:.1f}}}{}\n",
+               lengths[i], typewriter, growing,
+               i + 1 == std::size(lengths) ? "" : ",");
+  }
+  fmt::print("  ],\n");
+  printTextMemory(argv[1], font);
+  fmt::print("}}\n");
+  return 0;
+}
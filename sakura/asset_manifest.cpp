@@ -0,0 +1,201 @@
+#include "asset_manifest.h"
+#include "utf8.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+namespace sakura {
+
+namespace {
+
+void addCodePoints(std::vector<char32_t> &code_points,
+                   std::u32string_view text) {
+  for (auto c : text) {
+    if (c != U'\n' && c != U'\r') {
+      code_points.push_back(c);
+    }
+  }
+}
+
+void sortUnique(std::vector<char32_t> &code_points) {
+  std::sort(code_points.begin(), code_points.end());
+  code_points.erase(std::unique(code_points.begin(), code_points.end()),
+                    code_points.end());
+}
+
+bool isAssetArgument(const std::string &command, std::size_t index) {
+  return std::any_of(std::begin(ASSET_ARGUMENTS), std::end(ASSET_ARGUMENTS),
+                     [&](const AssetArgument &argument) {
+                       return command == argument.command &&
+                              index == argument.index;
+                     });
+}
+
+} // namespace
+
+AssetManifest::AssetManifest(elaina::ScriptEngine &script_engine,
+                             ResourceManager &resource_manager)
+    : script_engine_(script_engine), resource_manager_(resource_manager) {}
+
+const ScriptManifest &AssetManifest::script(const std::string &file_name) {
+  auto it = scripts_.find(file_name);
+  if (it != scripts_.end()) {
+    return it->second;
+  }
+  auto &manifest = scripts_[file_name];
+
+  const std::vector<std::unique_ptr<elaina::Ast>> *script = nullptr;
+  try {
+    script = &script_engine_.compile(file_name);
+  } catch (const std::exception &) {
+    return manifest;
+  }
+  for (auto &ast : *script) {
+    if (ast->type() != elaina::Ast::COMMAND) {
+      continue;
+    }
+    auto command = dynamic_cast<const elaina::CommandAst *>(ast.get());
+    for (std::size_t i = 0; i < command->args.size(); ++i) {
+      if (command->args[i]->type() == elaina::Ast::STRING &&
+          !isAssetArgument(command->command.value, i)) {
+        addCodePoints(manifest.code_points,
+                      dynamic_cast<const elaina::StringAst *>(
+                          command->args[i].get())
+                          ->text);
+      }
+    }
+    for (auto &argument : ASSET_ARGUMENTS) {
+      if (command->command.value != argument.command ||
+          argument.index >= command->args.size() ||
+          command->args[argument.index]->type() != elaina::Ast::STRING) {
+        continue;
+      }
+      auto arg = dynamic_cast<const elaina::StringAst *>(
+          command->args[argument.index].get());
+      switch (argument.kind) {
+      case AssetArgument::BACKGROUND:
+        manifest.backgrounds.push_back(arg->handle);
+        break;
+      case AssetArgument::SPRITE:
+        manifest.sprites.push_back(arg->handle);
+        break;
+      case AssetArgument::MUSIC:
+        manifest.music.push_back(arg->handle);
+        break;
+      case AssetArgument::SOUND:
+        manifest.sounds.push_back(arg->handle);
+        break;
+      case AssetArgument::SCENE:
+        manifest.scenes.push_back(arg->handle);
+        break;
+      case AssetArgument::SCRIPT:
+        manifest.successors.push_back(arg->value);
+        break;
+      }
+    }
+  }
+  for (auto id : manifest.scenes) {
+    if (id != INVALID_ASSET) {
+      auto &scene_manifest = scene(id);
+      manifest.successors.insert(manifest.successors.end(),
+                                 scene_manifest.successors.begin(),
+                                 scene_manifest.successors.end());
+      manifest.code_points.insert(manifest.code_points.end(),
+                                  scene_manifest.code_points.begin(),
+                                  scene_manifest.code_points.end());
+    }
+  }
+  sortUnique(manifest.code_points);
+  return manifest;
+}
+
+const AssetManifest::SceneManifest &AssetManifest::scene(AssetId id) {
+  auto it = scenes_.find(id);
+  if (it != scenes_.end()) {
+    return it->second;
+  }
+  auto &manifest = scenes_[id];
+
+  const SceneProto *proto = nullptr;
+  try {
+    proto = &resource_manager_.sceneProto(id);
+  } catch (const std::exception &) {
+    return manifest;
+  }
+  for (auto &texture : proto->textures) {
+    manifest.textures.push_back(resource_manager_.internTexture(texture));
+  }
+  manifest.font = resource_manager_.internFont(proto->font_face);
+  for (auto &widget : proto->widgets) {
+    for (auto &action : widget.actions) {
+      if (!action.empty()) {
+        manifest.successors.push_back(action);
+      }
+    }
+    addCodePoints(manifest.code_points, decodeUtf8(widget.text));
+  }
+  return manifest;
+}
+
+const AssetSet &AssetManifest::reachable(const std::string &file_name) {
+  auto it = reachable_.find(file_name);
+  if (it != reachable_.end()) {
+    return it->second;
+  }
+
+  AssetSet assets;
+  std::unordered_set<std::string> visited{file_name};
+  std::vector<std::string> queue{file_name};
+  while (!queue.empty()) {
+    auto &manifest = script(queue.back());
+    queue.pop_back();
+    assets.textures.insert(manifest.backgrounds.begin(),
+                           manifest.backgrounds.end());
+    assets.textures.insert(manifest.sprites.begin(), manifest.sprites.end());
+    assets.music.insert(manifest.music.begin(), manifest.music.end());
+    for (auto id : manifest.scenes) {
+      if (id == INVALID_ASSET) {
+        continue;
+      }
+      auto &scene_manifest = scene(id);
+      assets.scenes.insert(id);
+      assets.textures.insert(scene_manifest.textures.begin(),
+                             scene_manifest.textures.end());
+      assets.fonts.insert(scene_manifest.font);
+    }
+    for (auto &successor : manifest.successors) {
+      if (visited.insert(successor).second) {
+        queue.push_back(successor);
+      }
+    }
+  }
+  return reachable_[file_name] = std::move(assets);
+}
+
+const std::vector<char32_t> &
+AssetManifest::reachableCodePoints(const std::string &file_name) {
+  auto it = code_points_.find(file_name);
+  if (it != code_points_.end()) {
+    return it->second;
+  }
+
+  std::vector<char32_t> code_points;
+  std::unordered_set<std::string> visited{file_name};
+  std::vector<std::string> queue{file_name};
+  while (!queue.empty()) {
+    auto &manifest = script(queue.back());
+    queue.pop_back();
+    code_points.insert(code_points.end(), manifest.code_points.begin(),
+                       manifest.code_points.end());
+    for (auto &successor : manifest.successors) {
+      if (visited.insert(successor).second) {
+        queue.push_back(successor);
+      }
+    }
+  }
+  sortUnique(code_points);
+  return code_points_[file_name] = std::move(code_points);
+}
+
+} // namespace sakura
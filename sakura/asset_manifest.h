@@ -0,0 +1,90 @@
+#ifndef SAKURA_ASSET_MANIFEST_H
+#define SAKURA_ASSET_MANIFEST_H
+
+#include "asset_table.h"
+#include "elaina/script_engine.h"
+#include "resource_manager.h"
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sakura {
+
+// A string literal argument of a command which names an asset or a script.
+struct AssetArgument {
+  enum Kind { BACKGROUND, SPRITE, MUSIC, SOUND, SCENE, SCRIPT };
+
+  const char *command;
+  std::size_t index;
+  Kind kind;
+};
+
+inline constexpr AssetArgument ASSET_ARGUMENTS[] = {
+    {"background", 0, AssetArgument::BACKGROUND},
+    {"addSprite", 1, AssetArgument::SPRITE},
+    {"bgm", 0, AssetArgument::MUSIC},
+    {"voice", 0, AssetArgument::SOUND},
+    {"se", 0, AssetArgument::SOUND},
+    {"scene", 0, AssetArgument::SCENE},
+    {"jump", 0, AssetArgument::SCRIPT},
+    {"if", 1, AssetArgument::SCRIPT},
+    {"if", 2, AssetArgument::SCRIPT},
+    {"select", 1, AssetArgument::SCRIPT},
+    {"select", 3, AssetArgument::SCRIPT},
+};
+
+// The assets a script refers to directly, in the order they appear.
+struct ScriptManifest {
+  // textures shown as the background, the others at their native size
+  std::vector<AssetId> backgrounds;
+  std::vector<AssetId> sprites;
+  std::vector<AssetId> music;
+  // voice lines and sound effects
+  std::vector<AssetId> sounds;
+  std::vector<AssetId> scenes;
+  // scripts which may run after this one: @jump, @if, @select and the
+  // actions of the buttons of its scenes
+  std::vector<std::string> successors;
+  // of the text of its lines, names, selectors and its scenes, sorted
+  std::vector<char32_t> code_points;
+};
+
+// Static analysis of the scripts and scenes. Every asset is a string literal,
+// so what a script needs is known before it runs.
+class AssetManifest {
+public:
+  AssetManifest(elaina::ScriptEngine &script_engine,
+                ResourceManager &resource_manager);
+
+  // Parses the script if needed. A script which can't be parsed has an empty
+  // manifest, the error is reported when it is loaded.
+  const ScriptManifest &script(const std::string &file_name);
+  // The assets of `file_name` and of every script reachable from it.
+  const AssetSet &reachable(const std::string &file_name);
+  // The code points of `file_name` and of every script reachable from it,
+  // sorted.
+  const std::vector<char32_t> &reachableCodePoints(const std::string &file_name);
+
+private:
+  struct SceneManifest {
+    std::vector<AssetId> textures;
+    AssetId font = INVALID_ASSET;
+    std::vector<std::string> successors;
+    std::vector<char32_t> code_points;
+  };
+
+  const SceneManifest &scene(AssetId id);
+
+private:
+  elaina::ScriptEngine &script_engine_;
+  ResourceManager &resource_manager_;
+  std::unordered_map<std::string, ScriptManifest> scripts_;
+  std::unordered_map<AssetId, SceneManifest> scenes_;
+  std::unordered_map<std::string, AssetSet> reachable_;
+  std::unordered_map<std::string, std::vector<char32_t>> code_points_;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_ASSET_MANIFEST_H
@@ -0,0 +1,126 @@
+#ifndef SAKURA_ASSET_TABLE_H
+#define SAKURA_ASSET_TABLE_H
+
+#include <cstdint>
+#include <fmt/core.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace sakura {
+
+// An interned asset handle: the low 24 bits index a slot of an `AssetTable`,
+// the high 8 bits hold the generation of the slot when the handle was made.
+// Handles are resolved once from a file name, after that an access is a
+// bounds check and a generation compare. 0 is never a valid handle.
+using AssetId = std::uint32_t;
+
+constexpr AssetId INVALID_ASSET = 0;
+
+// `Info` is extra per-asset data kept alongside the loaded object.
+template <typename T, typename Info = std::monostate> class AssetTable {
+public:
+  static constexpr std::uint32_t INDEX_BITS = 24;
+  static constexpr std::uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+  struct Slot {
+    std::string name;
+    std::string path;
+    std::shared_ptr<T> data;
+    // content hash of the file, 0 if unknown
+    std::uint64_t content_hash = 0;
+    Info info{};
+    std::uint8_t generation = 1;
+    bool used = false;
+  };
+
+  // Slow path, hashes `name`.
+  AssetId find(const std::string &name) const {
+    auto it = ids_.find(name);
+    return it == ids_.end() ? INVALID_ASSET : it->second;
+  }
+
+  // Slow path, hashes `name` once. `path()` returns the resolved file path,
+  // it is only called for a new slot. The flag is true if the slot is new.
+  template <typename F>
+  std::pair<AssetId, bool> intern(const std::string &name, F &&path) {
+    auto [it, inserted] = ids_.try_emplace(name, INVALID_ASSET);
+    if (!inserted) {
+      return {it->second, false};
+    }
+    std::uint32_t index;
+    if (free_.empty()) {
+      if (slots_.size() > INDEX_MASK) {
+        ids_.erase(it);
+        throw std::runtime_error(fmt::format("{}: too many assets", name));
+      }
+      index = static_cast<std::uint32_t>(slots_.size());
+      slots_.emplace_back();
+    } else {
+      index = free_.back();
+      free_.pop_back();
+    }
+    auto &slot = slots_[index];
+    slot.name = name;
+    slot.path = path();
+    slot.used = true;
+    it->second = makeId(index, slot.generation);
+    return {it->second, true};
+  }
+
+  bool valid(AssetId id) const {
+    auto index = id & INDEX_MASK;
+    return index < slots_.size() && slots_[index].used &&
+           slots_[index].generation == (id >> INDEX_BITS);
+  }
+
+  Slot &operator[](AssetId id) {
+    if (!valid(id)) {
+      throw std::runtime_error(fmt::format("{:#x}: stale asset handle", id));
+    }
+    return slots_[id & INDEX_MASK];
+  }
+
+  const Slot &operator[](AssetId id) const {
+    return const_cast<AssetTable &>(*this)[id];
+  }
+
+  // Frees the slot, every handle to it becomes stale.
+  void release(AssetId id) {
+    auto &slot = (*this)[id];
+    ids_.erase(slot.name);
+    slot = Slot{{}, {}, nullptr, 0, {}, nextGeneration(slot.generation), false};
+    free_.push_back(id & INDEX_MASK);
+  }
+
+  template <typename F> void forEach(F &&func) {
+    for (std::uint32_t i = 0; i < slots_.size(); ++i) {
+      if (slots_[i].used) {
+        func(makeId(i, slots_[i].generation), slots_[i]);
+      }
+    }
+  }
+
+private:
+  static AssetId makeId(std::uint32_t index, std::uint8_t generation) {
+    return static_cast<AssetId>(generation) << INDEX_BITS | index;
+  }
+
+  static std::uint8_t nextGeneration(std::uint8_t generation) {
+    // skip 0 so that a handle is never INVALID_ASSET
+    return generation == 0xFF ? 1 : generation + 1;
+  }
+
+private:
+  std::vector<Slot> slots_;
+  std::vector<std::uint32_t> free_;
+  std::unordered_map<std::string, AssetId> ids_;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_ASSET_TABLE_H
@@ -0,0 +1,163 @@
+#include "audio.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace sakura {
+
+AudioSystem::AudioSystem(ResourceManager &resource_manager,
+                         std::size_t voice_count)
+    : resource_manager_(resource_manager), voices_(voice_count) {}
+
+void AudioSystem::setVoiceCount(std::size_t voice_count) {
+  voices_.clear();
+  voices_.resize(voice_count);
+  voice_line_ = NONE;
+}
+
+std::size_t AudioSystem::acquire(Priority priority) {
+  std::size_t victim = NONE;
+  for (std::size_t i = 0; i < voices_.size(); ++i) {
+    auto &voice = voices_[i];
+    if (voice.sound.getStatus() == sf::Sound::Stopped) {
+      return i;
+    }
+    if (voice.priority <= priority &&
+        (victim == NONE || voice.priority < voices_[victim].priority ||
+         (voice.priority == voices_[victim].priority &&
+          voice.started < voices_[victim].started))) {
+      victim = i;
+    }
+  }
+  if (victim != NONE) {
+    voices_[victim].sound.stop();
+  }
+  return victim;
+}
+
+std::size_t AudioSystem::start(AssetId sound, Priority priority) {
+  auto index = acquire(priority);
+  if (index == NONE) {
+    return NONE;
+  }
+  auto &voice = voices_[index];
+  voice.buffer = resource_manager_.loadSound(sound);
+  voice.sound.setBuffer(*voice.buffer);
+  voice.priority = priority;
+  voice.started = ++clock_;
+  voice.sound.play();
+  if (index == voice_line_) {
+    voice_line_ = NONE;
+  }
+  return index;
+}
+
+void AudioSystem::play(AssetId sound, Priority priority) {
+  start(sound, priority);
+}
+
+void AudioSystem::playVoice(AssetId sound) {
+  stopVoice();
+  voice_line_ = start(sound, VOICE);
+}
+
+void AudioSystem::stopVoice() {
+  if (voice_line_ != NONE) {
+    voices_[voice_line_].sound.stop();
+    voice_line_ = NONE;
+  }
+}
+
+void AudioSystem::playBgm(AssetId music, sf::Time fade) {
+  if (pending_.valid() && pending_id_ == music) {
+    return;
+  }
+  if (current_.music != nullptr && current_.id == music) {
+    if (pending_.valid()) {
+      // keep the current track instead of the one being opened
+      pending_id_ = INVALID_ASSET;
+    }
+    if (current_.music->getStatus() != sf::Music::Playing) {
+      current_.music->play();
+    }
+    return;
+  }
+  pending_ = resource_manager_.openMusic(music);
+  pending_id_ = music;
+  pending_fade_ = fade;
+}
+
+void AudioSystem::pauseBgm() {
+  if (current_.music != nullptr) {
+    current_.music->pause();
+  }
+}
+
+void AudioSystem::stopBgm(sf::Time fade) {
+  if (pending_.valid()) {
+    pending_id_ = INVALID_ASSET;
+  }
+  if (current_.music == nullptr) {
+    return;
+  }
+  if (fading_.music != nullptr) {
+    fading_.music->stop();
+  }
+  fading_ = std::move(current_);
+  current_ = Track{};
+  AudioSystem::fade(fading_, 0.0f, fade);
+}
+
+void AudioSystem::fade(Track &track, float target, sf::Time duration) {
+  track.target = target;
+  track.rate = duration > sf::Time::Zero
+                   ? std::abs(target - track.volume) / duration.asSeconds()
+                   : 0.0f;
+}
+
+void AudioSystem::advance(Track &track, sf::Time elapsed) {
+  if (track.music == nullptr || track.volume == track.target) {
+    return;
+  }
+  if (track.rate == 0.0f) {
+    track.volume = track.target;
+  } else {
+    auto delta = track.rate * elapsed.asSeconds();
+    track.volume = track.volume < track.target
+                       ? std::min(track.volume + delta, track.target)
+                       : std::max(track.volume - delta, track.target);
+  }
+  track.music->setVolume(track.volume * 100.0f);
+}
+
+void AudioSystem::update(sf::Time elapsed) {
+  if (pending_.valid() && pending_.ready()) {
+    auto music = std::exchange(pending_, {}).get();
+    if (pending_id_ != INVALID_ASSET) {
+      stopBgm(pending_fade_);
+      current_.music = std::move(music);
+      current_.id = pending_id_;
+      current_.music->setLoop(true);
+      current_.music->setVolume(0.0f);
+      current_.music->play();
+      fade(current_, 1.0f, pending_fade_);
+    }
+  }
+  advance(current_, elapsed);
+  advance(fading_, elapsed);
+  if (fading_.music != nullptr && fading_.volume == 0.0f) {
+    fading_.music->stop();
+    fading_ = Track{};
+  }
+
+  // let the cache drop buffers which are done playing
+  for (auto &voice : voices_) {
+    if (voice.buffer != nullptr &&
+        voice.sound.getStatus() == sf::Sound::Stopped) {
+      voice.sound.resetBuffer();
+      voice.buffer = nullptr;
+    }
+  }
+}
+
+} // namespace sakura
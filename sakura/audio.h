@@ -0,0 +1,84 @@
+#ifndef SAKURA_AUDIO_H
+#define SAKURA_AUDIO_H
+
+#include "asset_table.h"
+#include "resource_manager.h"
+#include <SFML/Audio.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sakura {
+
+// Sound effects and voice lines play on a fixed pool of `sf::Sound`s, BGM
+// crossfades between two streams.
+class AudioSystem {
+public:
+  // When the pool is full a sound steals the oldest voice of the lowest
+  // priority not higher than its own, or is dropped.
+  enum Priority : std::uint8_t { EFFECT, VOICE };
+
+  explicit AudioSystem(ResourceManager &resource_manager,
+                       std::size_t voice_count = 16);
+
+  // Stops everything which is playing.
+  void setVoiceCount(std::size_t voice_count);
+
+  // Starts at once if the sound has been prefetched.
+  void play(AssetId sound, Priority priority);
+  // Stops the voice line which is playing, if any, then plays `sound`.
+  void playVoice(AssetId sound);
+  void stopVoice();
+
+  // The new track is opened on a worker thread and fades in when it is ready
+  // while the current one fades out. Playing the paused track resumes it.
+  void playBgm(AssetId music, sf::Time fade = sf::seconds(1.0f));
+  void pauseBgm();
+  void stopBgm(sf::Time fade = sf::seconds(1.0f));
+
+  // Call once per frame.
+  void update(sf::Time elapsed);
+
+private:
+  struct Voice {
+    sf::Sound sound;
+    std::shared_ptr<sf::SoundBuffer> buffer;
+    Priority priority = EFFECT;
+    std::uint64_t started = 0;
+  };
+
+  struct Track {
+    std::shared_ptr<sf::Music> music;
+    AssetId id = INVALID_ASSET;
+    // 0 to 1
+    float volume = 0.0f;
+    float target = 0.0f;
+    // volume per second, 0 jumps to the target
+    float rate = 0.0f;
+  };
+
+  static constexpr std::size_t NONE = SIZE_MAX;
+
+  std::size_t acquire(Priority priority);
+  std::size_t start(AssetId sound, Priority priority);
+  static void fade(Track &track, float target, sf::Time duration);
+  static void advance(Track &track, sf::Time elapsed);
+
+private:
+  ResourceManager &resource_manager_;
+  std::vector<Voice> voices_;
+  std::uint64_t clock_ = 0;
+  // the voice playing the current voice line
+  std::size_t voice_line_ = NONE;
+
+  Track current_;
+  Track fading_;
+  Job<std::shared_ptr<sf::Music>> pending_;
+  AssetId pending_id_ = INVALID_ASSET;
+  sf::Time pending_fade_;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_AUDIO_H
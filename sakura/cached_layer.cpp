@@ -0,0 +1,74 @@
+#include "cached_layer.h"
+#include "cooked_texture.h"
+#include <algorithm>
+#include <cmath>
+
+namespace sakura {
+
+void CachedLayer::invalidate() { dirty_ = true; }
+
+bool CachedLayer::record(DrawList &list, const sf::RenderTarget &target,
+                         sf::FloatRect bounds,
+                         const std::function<void(sf::RenderTarget &)> &paint) {
+  if (bounds.width <= 0 || bounds.height <= 0) {
+    return true;
+  }
+  if (disabled_) {
+    return false;
+  }
+
+  // snap the bounds to window pixels, so that the quad maps texels 1:1
+  const auto &view = target.getView();
+  auto target_size = target.getSize();
+  sf::Vector2f scale{target_size.x / view.getSize().x,
+                     target_size.y / view.getSize().y};
+  sf::Vector2f origin = view.getCenter() - view.getSize() / 2.0f;
+  auto left = std::floor((bounds.left - origin.x) * scale.x);
+  auto top = std::floor((bounds.top - origin.y) * scale.y);
+  auto right = std::ceil((bounds.left + bounds.width - origin.x) * scale.x);
+  auto bottom = std::ceil((bounds.top + bounds.height - origin.y) * scale.y);
+  bounds = {origin.x + left / scale.x, origin.y + top / scale.y,
+            (right - left) / scale.x, (bottom - top) / scale.y};
+
+  if (dirty_ || bounds != bounds_ || target_size != target_size_) {
+    sf::Vector2u size{static_cast<unsigned>(right - left),
+                      static_cast<unsigned>(bottom - top)};
+    if (texture_ == nullptr || texture_.use_count() > 1) {
+      // a recorded frame may still draw the current composite
+      if (spare_ == nullptr || spare_.use_count() > 1) {
+        spare_ = std::make_shared<sf::RenderTexture>();
+      }
+      std::swap(texture_, spare_);
+    }
+    auto capacity = texture_->getSize();
+    if ((capacity.x < size.x || capacity.y < size.y) &&
+        !texture_->create(std::max(capacity.x, size.x),
+                          std::max(capacity.y, size.y))) {
+      disabled_ = true;
+      texture_ = spare_ = nullptr;
+      return false;
+    }
+    capacity = texture_->getSize();
+    sf::View layer_view(bounds);
+    layer_view.setViewport({0, 0, static_cast<float>(size.x) / capacity.x,
+                            static_cast<float>(size.y) / capacity.y});
+    texture_->setView(layer_view);
+    texture_->clear(sf::Color::Transparent);
+    paint(*texture_);
+    texture_->display();
+    bounds_ = bounds;
+    size_ = size;
+    target_size_ = target_size;
+    dirty_ = false;
+  }
+
+  // everything painted is premultiplied, and so is the composite
+  sf::RenderStates states(BlendPremultipliedAlpha);
+  states.texture = &texture_->getTexture();
+  list.addRect(bounds_, states,
+               {0, 0, static_cast<float>(size_.x), static_cast<float>(size_.y)});
+  list.retain(texture_);
+  return true;
+}
+
+} // namespace sakura
@@ -0,0 +1,44 @@
+#ifndef SAKURA_CACHED_LAYER_H
+#define SAKURA_CACHED_LAYER_H
+
+#include "draw_list.h"
+#include <SFML/Graphics.hpp>
+#include <functional>
+#include <memory>
+
+namespace sakura {
+
+// Content composited once into a render texture, then drawn as a single quad
+// every frame until it is invalidated. The render texture only grows, so a
+// layer reused for other content, as the engine does across scenes, is
+// painted again without allocating.
+class CachedLayer {
+public:
+  void invalidate();
+
+  // `paint` draws the content in design units, `bounds` must contain it.
+  // The layer is composited again when it has been invalidated or the size
+  // or view of `target` or `bounds` changed, then its quad is appended to
+  // `list`, which keeps the composite alive. A composite a list still holds
+  // is never painted over. Returns false, appending nothing, if the layer
+  // can't be composited, the caller then records the content itself.
+  bool record(DrawList &list, const sf::RenderTarget &target,
+              sf::FloatRect bounds,
+              const std::function<void(sf::RenderTarget &)> &paint);
+
+private:
+  std::shared_ptr<sf::RenderTexture> texture_;
+  // the previous composite, reused once no list holds it
+  std::shared_ptr<sf::RenderTexture> spare_;
+  sf::FloatRect bounds_;
+  // the part of `texture_` painted
+  sf::Vector2u size_;
+  sf::Vector2u target_size_;
+  bool dirty_ = true;
+  // no render texture support, paint every frame
+  bool disabled_ = false;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_CACHED_LAYER_H
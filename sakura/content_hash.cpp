@@ -0,0 +1,171 @@
+#include "content_hash.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace sakura {
+
+namespace {
+
+constexpr std::uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+inline std::uint64_t rotl(std::uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline std::uint64_t read64(const unsigned char *p) {
+  std::uint64_t v = 0;
+  for (int i = 7; i >= 0; --i) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+inline std::uint32_t read32(const unsigned char *p) {
+  return static_cast<std::uint32_t>(p[0]) |
+         static_cast<std::uint32_t>(p[1]) << 8 |
+         static_cast<std::uint32_t>(p[2]) << 16 |
+         static_cast<std::uint32_t>(p[3]) << 24;
+}
+
+inline std::uint64_t round(std::uint64_t acc, std::uint64_t input) {
+  acc += input * PRIME_2;
+  acc = rotl(acc, 31);
+  return acc * PRIME_1;
+}
+
+inline std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t lane) {
+  acc ^= round(0, lane);
+  return acc * PRIME_1 + PRIME_4;
+}
+
+} // namespace
+
+ContentHasher::ContentHasher(std::uint64_t seed)
+    : seed_(seed), lanes_{seed + PRIME_1 + PRIME_2, seed + PRIME_2, seed,
+                          seed - PRIME_1} {}
+
+void ContentHasher::update(const void *data, std::size_t size) {
+  auto p = static_cast<const unsigned char *>(data);
+  total_size_ += size;
+
+  if (buffered_ + size < buffer_.size()) {
+    std::memcpy(buffer_.data() + buffered_, p, size);
+    buffered_ += size;
+    return;
+  }
+
+  if (buffered_ != 0) {
+    auto fill = buffer_.size() - buffered_;
+    std::memcpy(buffer_.data() + buffered_, p, fill);
+    for (std::size_t i = 0; i < 4; ++i) {
+      lanes_[i] = round(lanes_[i], read64(buffer_.data() + i * 8));
+    }
+    p += fill;
+    size -= fill;
+    buffered_ = 0;
+  }
+
+  while (size >= 32) {
+    for (std::size_t i = 0; i < 4; ++i) {
+      lanes_[i] = round(lanes_[i], read64(p + i * 8));
+    }
+    p += 32;
+    size -= 32;
+  }
+
+  std::memcpy(buffer_.data(), p, size);
+  buffered_ = size;
+}
+
+std::uint64_t ContentHasher::digest() const {
+  std::uint64_t h;
+  if (total_size_ >= 32) {
+    h = rotl(lanes_[0], 1) + rotl(lanes_[1], 7) + rotl(lanes_[2], 12) +
+        rotl(lanes_[3], 18);
+    for (auto lane : lanes_) {
+      h = mergeRound(h, lane);
+    }
+  } else {
+    h = seed_ + PRIME_5;
+  }
+  h += total_size_;
+
+  const unsigned char *p = buffer_.data();
+  std::size_t size = buffered_;
+  while (size >= 8) {
+    h ^= round(0, read64(p));
+    h = rotl(h, 27) * PRIME_1 + PRIME_4;
+    p += 8;
+    size -= 8;
+  }
+  if (size >= 4) {
+    h ^= static_cast<std::uint64_t>(read32(p)) * PRIME_1;
+    h = rotl(h, 23) * PRIME_2 + PRIME_3;
+    p += 4;
+    size -= 4;
+  }
+  while (size > 0) {
+    h ^= *p * PRIME_5;
+    h = rotl(h, 11) * PRIME_1;
+    ++p;
+    --size;
+  }
+
+  h ^= h >> 33;
+  h *= PRIME_2;
+  h ^= h >> 29;
+  h *= PRIME_3;
+  h ^= h >> 32;
+  return h;
+}
+
+std::uint64_t hashContent(const void *data, std::size_t size) {
+  ContentHasher hasher;
+  hasher.update(data, size);
+  return hasher.digest();
+}
+
+std::uint64_t hashFile(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return 0;
+  }
+  ContentHasher hasher;
+  char buffer[64 * 1024];
+  while (file) {
+    file.read(buffer, sizeof(buffer));
+    hasher.update(buffer, static_cast<std::size_t>(file.gcount()));
+  }
+  return hasher.digest();
+}
+
+bool readFile(const std::filesystem::path &path, std::vector<char> &bytes,
+              std::uint64_t &hash) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return false;
+  }
+  auto size = static_cast<std::size_t>(file.tellg());
+  file.seekg(0);
+  bytes.resize(size);
+
+  ContentHasher hasher;
+  constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+  for (std::size_t offset = 0; offset < size; offset += CHUNK_SIZE) {
+    auto chunk = std::min(CHUNK_SIZE, size - offset);
+    if (!file.read(bytes.data() + offset,
+                   static_cast<std::streamsize>(chunk))) {
+      return false;
+    }
+    hasher.update(bytes.data() + offset, chunk);
+  }
+  hash = hasher.digest();
+  return true;
+}
+
+} // namespace sakura
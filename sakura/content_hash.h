@@ -0,0 +1,39 @@
+#ifndef SAKURA_CONTENT_HASH_H
+#define SAKURA_CONTENT_HASH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace sakura {
+
+// Streaming XXH64. Used to identify asset contents, it is fast but not
+// cryptographic.
+class ContentHasher {
+public:
+  explicit ContentHasher(std::uint64_t seed = 0);
+  void update(const void *data, std::size_t size);
+  std::uint64_t digest() const;
+
+private:
+  std::uint64_t seed_;
+  std::array<std::uint64_t, 4> lanes_;
+  std::array<unsigned char, 32> buffer_;
+  std::size_t buffered_ = 0;
+  std::uint64_t total_size_ = 0;
+};
+
+std::uint64_t hashContent(const void *data, std::size_t size);
+
+// Returns 0 if the file can't be read.
+std::uint64_t hashFile(const std::filesystem::path &path);
+
+// Reads the whole file into `bytes`, hashing it on the way.
+bool readFile(const std::filesystem::path &path, std::vector<char> &bytes,
+              std::uint64_t &hash);
+
+} // namespace sakura
+
+#endif // !SAKURA_CONTENT_HASH_H
@@ -0,0 +1,139 @@
+#include "cooked_texture.h"
+#include <cstring>
+#include <fstream>
+
+namespace sakura {
+
+namespace {
+
+constexpr std::uint16_t COOKED_TEXTURE_VERSION = 1;
+
+bool isValid(const CookedTextureHeader &header) {
+  return std::memcmp(header.magic, "SKTX", 4) == 0 &&
+         header.version == COOKED_TEXTURE_VERSION &&
+         (header.flags & CookedTextureHeader::PREMULTIPLIED_ALPHA) &&
+         header.width != 0 && header.height != 0;
+}
+
+bool readHeader(std::istream &stream, CookedTextureHeader &header) {
+  stream.read(header.magic, sizeof(header.magic));
+  stream.read(reinterpret_cast<char *>(&header.version),
+              sizeof(header.version));
+  stream.read(reinterpret_cast<char *>(&header.flags), sizeof(header.flags));
+  stream.read(reinterpret_cast<char *>(&header.width), sizeof(header.width));
+  stream.read(reinterpret_cast<char *>(&header.height), sizeof(header.height));
+  stream.read(reinterpret_cast<char *>(&header.source_hash),
+              sizeof(header.source_hash));
+  return stream.good() && isValid(header);
+}
+
+} // namespace
+
+std::filesystem::path cookedTexturePath(const std::filesystem::path &source) {
+  auto path = source;
+  path += ".sktx";
+  return path;
+}
+
+void premultiplyAlpha(std::uint8_t *pixels, std::size_t pixel_count) {
+  for (std::size_t i = 0; i < pixel_count; ++i, pixels += 4) {
+    unsigned alpha = pixels[3];
+    for (int c = 0; c < 3; ++c) {
+      // (x * a + 127) / 255 without the division
+      unsigned v = pixels[c] * alpha + 128;
+      pixels[c] = static_cast<std::uint8_t>((v + (v >> 8)) >> 8);
+    }
+  }
+}
+
+bool readCookedTextureHeader(const std::filesystem::path &path,
+                             CookedTextureHeader &header) {
+  std::ifstream file(path, std::ios::binary);
+  return file.is_open() && readHeader(file, header);
+}
+
+bool writeCookedTexture(const std::filesystem::path &path,
+                        const CookedTextureHeader &header,
+                        const std::uint8_t *pixels) {
+  auto temp = path;
+  temp += ".tmp";
+  {
+    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      return false;
+    }
+    file.write(header.magic, sizeof(header.magic));
+    file.write(reinterpret_cast<const char *>(&header.version),
+               sizeof(header.version));
+    file.write(reinterpret_cast<const char *>(&header.flags),
+               sizeof(header.flags));
+    file.write(reinterpret_cast<const char *>(&header.width),
+               sizeof(header.width));
+    file.write(reinterpret_cast<const char *>(&header.height),
+               sizeof(header.height));
+    file.write(reinterpret_cast<const char *>(&header.source_hash),
+               sizeof(header.source_hash));
+    file.write(reinterpret_cast<const char *>(pixels),
+               static_cast<std::streamsize>(header.width) * header.height * 4);
+    if (!file.good()) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp, path, ec);
+  return !ec;
+}
+
+namespace {
+
+bool isUpToDate(const std::filesystem::path &source,
+                const std::filesystem::path &cooked) {
+  std::error_code ec;
+  auto cooked_time = std::filesystem::last_write_time(cooked, ec);
+  if (ec) {
+    return false;
+  }
+  auto source_time = std::filesystem::last_write_time(source, ec);
+  return ec || source_time <= cooked_time;
+}
+
+} // namespace
+
+bool findCookedTexture(const std::filesystem::path &source,
+                       CookedTextureHeader &header) {
+  auto path = cookedTexturePath(source);
+  return isUpToDate(source, path) && readCookedTextureHeader(path, header);
+}
+
+bool readCookedTexture(const std::filesystem::path &source,
+                       CookedTextureHeader &header,
+                       std::vector<std::uint8_t> &pixels) {
+  auto path = cookedTexturePath(source);
+  if (!isUpToDate(source, path)) {
+    return false;
+  }
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open() || !readHeader(file, header)) {
+    return false;
+  }
+  // a corrupt header must not make us allocate more than the file holds
+  auto max_size = sf::Texture::getMaximumSize();
+  if (header.width > max_size || header.height > max_size) {
+    return false;
+  }
+  auto size = std::uint64_t{header.width} * header.height * 4;
+  std::error_code ec;
+  auto file_size = std::filesystem::file_size(path, ec);
+  auto offset = file.tellg();
+  if (ec || offset == std::istream::pos_type(-1) ||
+      file_size < static_cast<std::uint64_t>(offset) + size) {
+    return false;
+  }
+  pixels.resize(static_cast<std::size_t>(size));
+  file.read(reinterpret_cast<char *>(pixels.data()),
+            static_cast<std::streamsize>(pixels.size()));
+  return file.good();
+}
+
+} // namespace sakura
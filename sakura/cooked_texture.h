@@ -0,0 +1,62 @@
+#ifndef SAKURA_COOKED_TEXTURE_H
+#define SAKURA_COOKED_TEXTURE_H
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace sakura {
+
+// Cooked texture file (*.sktx):
+// {
+//   "magic": "SKTX",
+//   "version": u16,
+//   "flags": u16,
+//   "width": u32,
+//   "height": u32,
+//   "source_hash": u64, content hash of the source image
+//   "pixels": width * height * RGBA8
+// }
+struct CookedTextureHeader {
+  enum Flag : std::uint16_t { PREMULTIPLIED_ALPHA = 1 };
+
+  char magic[4] = {'S', 'K', 'T', 'X'};
+  std::uint16_t version = 1;
+  std::uint16_t flags = 0;
+  std::uint32_t width = 0;
+  std::uint32_t height = 0;
+  std::uint64_t source_hash = 0;
+};
+
+// All textures loaded by the engine have premultiplied alpha, so they must be
+// drawn with this blend mode.
+inline const sf::BlendMode BlendPremultipliedAlpha{
+    sf::BlendMode::One, sf::BlendMode::OneMinusSrcAlpha};
+
+std::filesystem::path cookedTexturePath(const std::filesystem::path &source);
+
+void premultiplyAlpha(std::uint8_t *pixels, std::size_t pixel_count);
+
+bool readCookedTextureHeader(const std::filesystem::path &path,
+                             CookedTextureHeader &header);
+
+bool writeCookedTexture(const std::filesystem::path &path,
+                        const CookedTextureHeader &header,
+                        const std::uint8_t *pixels);
+
+// Reads the header of the cooked form of `source` if it exists and is not
+// older than `source`.
+bool findCookedTexture(const std::filesystem::path &source,
+                       CookedTextureHeader &header);
+
+// Reads the cooked form of `source` if it exists and is not older than
+// `source`. Returns false so that the caller can fall back to decoding, also
+// if the file is truncated or its size exceeds what a texture can hold.
+bool readCookedTexture(const std::filesystem::path &source,
+                       CookedTextureHeader &header,
+                       std::vector<std::uint8_t> &pixels);
+
+} // namespace sakura
+
+#endif // !SAKURA_COOKED_TEXTURE_H
@@ -1,33 +1,20 @@
-#include "utility.h"
+#include "utf8.h"
 #include "widget.h"
+#include <algorithm>
 
 namespace sakura {
 
-void Dialog::render(sf::RenderTarget &render_target) const {
-  render_target.draw(shape);
-  for (auto &child : children) {
-    child->render(render_target);
-  }
-  render_target.draw(name);
-  render_target.draw(text);
+void Dialog::setText(const TextLayout &layout, const GlyphSource &glyphs) {
+  text.setLayout(layout, glyphs);
 }
 
-std::string Dialog::on(const sf::Event &event) const {
-  for (auto &child : children) {
-    auto action = child->on(event);
-    if (!action.empty()) {
-      return action;
-    }
-  }
-  return {};
+float Dialog::textWidth() const {
+  auto margin = text.getPosition().x - frame.left;
+  return std::max(0.0f, frame.width - 2 * margin);
 }
 
-void Dialog::setText(const std::string &text) {
-  this->text.setString(utf8ToWstring(text));
-}
-
-void Dialog::setName(const std::string &name) {
-  this->name.setString(utf8ToWstring(name));
+void Dialog::setName(std::u32string_view name) {
+  this->name.setString(toSfString(name));
 }
 
 } // namespace sakura
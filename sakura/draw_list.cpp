@@ -0,0 +1,84 @@
+#include "draw_list.h"
+#include <algorithm>
+
+namespace sakura {
+
+namespace {
+
+bool sameStates(const sf::RenderStates &lhs, const sf::RenderStates &rhs) {
+  const auto *lhs_matrix = lhs.transform.getMatrix();
+  const auto *rhs_matrix = rhs.transform.getMatrix();
+  return lhs.texture == rhs.texture && lhs.shader == rhs.shader &&
+         lhs.blendMode == rhs.blendMode &&
+         std::equal(lhs_matrix, lhs_matrix + 16, rhs_matrix);
+}
+
+} // namespace
+
+void DrawList::add(const sf::Vertex *vertices, std::size_t count,
+                   const sf::RenderStates &states) {
+  if (count == 0) {
+    return;
+  }
+  if (commands_.empty() || commands_.back().text != NO_TEXT ||
+      !sameStates(commands_.back().states, states)) {
+    commands_.push_back({states, vertices_.size(), 0});
+  }
+  vertices_.insert(vertices_.end(), vertices, vertices + count);
+  commands_.back().count += count;
+}
+
+void DrawList::addRect(const sf::FloatRect &rect,
+                       const sf::RenderStates &states,
+                       const sf::FloatRect &texture_rect) {
+  auto coords = texture_rect;
+  if (states.texture != nullptr &&
+      (coords.width <= 0 || coords.height <= 0)) {
+    auto size = static_cast<sf::Vector2f>(states.texture->getSize());
+    coords = {0, 0, size.x, size.y};
+  }
+  sf::Vector2f tl{rect.left, rect.top};
+  sf::Vector2f tr{rect.left + rect.width, rect.top};
+  sf::Vector2f bl{rect.left, rect.top + rect.height};
+  sf::Vector2f br{rect.left + rect.width, rect.top + rect.height};
+  sf::Vector2f tex_tl{coords.left, coords.top};
+  sf::Vector2f tex_tr{coords.left + coords.width, coords.top};
+  sf::Vector2f tex_bl{coords.left, coords.top + coords.height};
+  sf::Vector2f tex_br{coords.left + coords.width, coords.top + coords.height};
+  const sf::Vertex quad[] = {{tl, tex_tl}, {tr, tex_tr}, {bl, tex_bl},
+                             {bl, tex_bl}, {tr, tex_tr}, {br, tex_br}};
+  add(quad, 6, states);
+}
+
+void DrawList::addText(const sf::Text &text, const sf::RenderStates &states) {
+  commands_.push_back({states, 0, 0, texts_.size()});
+  texts_.push_back(text);
+}
+
+void DrawList::retain(std::shared_ptr<const void> object) {
+  if (object != nullptr) {
+    retained_.push_back(std::move(object));
+  }
+}
+
+void DrawList::clear() {
+  vertices_.clear();
+  commands_.clear();
+  texts_.clear();
+  retained_.clear();
+}
+
+std::size_t DrawList::commandCount() const { return commands_.size(); }
+
+void DrawList::draw(sf::RenderTarget &target) const {
+  for (auto &command : commands_) {
+    if (command.text != NO_TEXT) {
+      target.draw(texts_[command.text], command.states);
+    } else {
+      target.draw(vertices_.data() + command.first, command.count,
+                  sf::Triangles, command.states);
+    }
+  }
+}
+
+} // namespace sakura
@@ -0,0 +1,57 @@
+#ifndef SAKURA_DRAW_LIST_H
+#define SAKURA_DRAW_LIST_H
+
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace sakura {
+
+// What a frame draws, recorded once and drawn later, possibly on another
+// thread: copies of vertices and texts with the states to draw them with,
+// and shared ownership of what they refer to. Consecutive vertices with the
+// same states are drawn in one call.
+class DrawList {
+public:
+  void add(const sf::Vertex *vertices, std::size_t count,
+           const sf::RenderStates &states);
+  // Two triangles covering `rect`, mapped to `texture_rect` of `texture` if
+  // any, or to the whole texture if `texture_rect` is empty.
+  void addRect(const sf::FloatRect &rect, const sf::RenderStates &states,
+               const sf::FloatRect &texture_rect = {});
+  // A copy of `text`. Its font may lay it out again when drawn, which is
+  // safe only under `gpuMutex`.
+  void addText(const sf::Text &text, const sf::RenderStates &states = {});
+  // Keeps `object` alive as long as the list refers to it.
+  void retain(std::shared_ptr<const void> object);
+  void clear();
+  std::size_t commandCount() const;
+
+  void draw(sf::RenderTarget &target) const;
+
+public:
+  // when recording started
+  std::chrono::steady_clock::time_point recorded;
+
+private:
+  static constexpr std::size_t NO_TEXT = SIZE_MAX;
+
+  struct Command {
+    sf::RenderStates states;
+    std::size_t first;
+    std::size_t count;
+    std::size_t text = NO_TEXT;
+  };
+
+private:
+  std::vector<sf::Vertex> vertices_;
+  std::vector<Command> commands_;
+  std::vector<sf::Text> texts_;
+  std::vector<std::shared_ptr<const void>> retained_;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_DRAW_LIST_H
@@ -2,8 +2,10 @@
 #define SAKURA_ELAINA_AST_H
 
 #include "token.h"
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace sakura {
@@ -25,10 +27,16 @@ struct IntegerAst : public Ast {
 };
 
 struct StringAst : public Ast {
-  explicit StringAst(const std::string &value) : value(value) {}
+  StringAst(const std::string &value, std::u32string text)
+      : value(value), text(std::move(text)) {}
   Type type() const override { return STRING; }
 
   std::string value;
+  // `value` decoded once when the script is parsed
+  std::u32string text;
+  // set when the script is loaded if the string names an asset, see
+  // `ScriptEngine::registerAssetArgument`
+  std::uint32_t handle = 0;
 };
 
 struct IdentifierAst : public Ast {
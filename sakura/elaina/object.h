@@ -1,7 +1,9 @@
 #ifndef SAKURA_ELAINA_OBJECT_H
 #define SAKURA_ELAINA_OBJECT_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace sakura {
 
@@ -13,6 +15,8 @@ struct Object {
   virtual Type type() const = 0;
   virtual int getInt() const { return {}; }
   virtual std::string getString() const { return {}; }
+  virtual std::u32string_view getText() const { return {}; }
+  virtual std::uint32_t getHandle() const { return {}; }
 };
 
 struct Integer : public Object {
@@ -24,11 +28,18 @@ struct Integer : public Object {
 };
 
 struct String : public Object {
-  explicit String(const std::string &value) : value(value) {}
+  String(const std::string &value, std::u32string_view text,
+         std::uint32_t handle)
+      : value(value), text(text), handle(handle) {}
   Type type() const override { return STRING; }
   std::string getString() const override { return value; }
+  std::u32string_view getText() const override { return text; }
+  std::uint32_t getHandle() const override { return handle; }
 
   std::string value;
+  // decoded `value`, owned by the script, which stays cached
+  std::u32string_view text;
+  std::uint32_t handle;
 };
 
 } // namespace elaina
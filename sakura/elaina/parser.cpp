@@ -1,4 +1,5 @@
 #include "parser.h"
+#include "../utf8.h"
 #include <fmt/core.h>
 #include <magic_enum.hpp>
 #include <stdexcept>
@@ -27,6 +28,16 @@ Token Parser::match(Token::Type type) {
       token.col_num, magic_enum::enum_name(token.type), token.value));
 }
 
+StringAst *Parser::makeString(const Token &token) {
+  try {
+    return new StringAst{token.value, decodeUtf8(token.value)};
+  } catch (const std::runtime_error &e) {
+    throw std::runtime_error(fmt::format("{}:{}:{}: {}", lexer_.file_name,
+                                         token.row_num, token.col_num,
+                                         e.what()));
+  }
+}
+
 std::unique_ptr<Ast> Parser::parseAst() {
   const auto &token = lexer_.peek();
   switch (token.type) {
@@ -45,7 +56,7 @@ std::unique_ptr<Ast> Parser::parseAst() {
 
 std::unique_ptr<Ast> Parser::parseAssignment() {
   auto res = new CommandAst;
-  res->args.emplace_back(new StringAst{lexer_.next().value});
+  res->args.emplace_back(makeString(lexer_.next()));
   res->command = match(Token::ASSIGN);
   res->args.emplace_back(parseExpr());
   return std::unique_ptr<Ast>{res};
@@ -75,8 +86,7 @@ std::unique_ptr<Ast> Parser::parseCommand() {
       }
       break;
     case Token::STRING:
-      res->args.emplace_back(
-          std::unique_ptr<Ast>{new StringAst(lexer_.next().value)});
+      res->args.emplace_back(std::unique_ptr<Ast>{makeString(lexer_.next())});
       break;
     default:
       throw std::runtime_error(fmt::format("{}:{}:{}: unexpected token '{}'",
@@ -92,8 +102,8 @@ std::unique_ptr<Ast> Parser::parseDialogue() {
   auto name_block = lexer_.next();
   res->command =
       Token{Token::COMMAND, name_block.row_num, name_block.col_num, "say"};
-  res->args.emplace_back(new StringAst{name_block.value});
-  res->args.emplace_back(new StringAst{match(Token::STRING).value});
+  res->args.emplace_back(makeString(name_block));
+  res->args.emplace_back(makeString(match(Token::STRING)));
   return std::unique_ptr<Ast>{res};
 }
 
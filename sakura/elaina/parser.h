@@ -18,6 +18,7 @@ public:
 
 private:
   Token match(Token::Type type);
+  StringAst *makeString(const Token &token);
   std::unique_ptr<Ast> parseAst();
   std::unique_ptr<Ast> parseAssignment();
   std::unique_ptr<Ast> parseCommand();
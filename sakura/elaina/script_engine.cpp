@@ -11,6 +11,22 @@ namespace sakura {
 
 namespace elaina {
 
+namespace {
+
+// Touches nothing but the file, so that it can run on a worker.
+std::vector<std::unique_ptr<Ast>> parse(const std::filesystem::path &prefix,
+                                        const std::string &file_name) {
+  std::ifstream file(concat_if_relative(prefix, file_name));
+  if (!file.is_open()) {
+    throw std::runtime_error(fmt::format("{}: can't open file", file_name));
+  }
+  Lexer lexer(file_name, file);
+  Parser parser(lexer);
+  return parser.parse();
+}
+
+} // namespace
+
 ScriptEngine::ScriptEngine() {
   registerCommand(":=",
                   std::function<void(ScriptEngine &)>{[this](ScriptEngine &) {
@@ -99,26 +115,69 @@ ScriptEngine::ScriptEngine() {
 }
 
 void ScriptEngine::loadScript(const std::string &file_name, std::size_t index) {
+  compile(file_name);
+  ptr_to_script_ = &*scripts_.find(file_name);
+  this->index_ = index;
+}
+
+const std::vector<std::unique_ptr<Ast>> &
+ScriptEngine::compile(const std::string &file_name) {
   auto it = scripts_.find(file_name);
   if (it == scripts_.end()) {
-    std::ifstream file(concat_if_relative(script_dir_prefix, file_name));
-    if (!file.is_open()) {
-      throw std::runtime_error(fmt::format("{}: can't open file", file_name));
+    std::vector<std::unique_ptr<Ast>> script;
+    auto pending = pending_scripts_.find(file_name);
+    if (pending != pending_scripts_.end()) {
+      auto job = std::move(pending->second);
+      pending_scripts_.erase(pending);
+      script = job.get();
+    } else {
+      script = parse(script_dir_prefix, file_name);
     }
-    Lexer lexer(file_name, file);
-    Parser parser(lexer);
-    scripts_.emplace(file_name, parser.parse());
-    it = scripts_.find(file_name);
+    resolveAssets(script);
+    it = scripts_
+             .emplace(file_name,
+                      std::make_shared<std::vector<std::unique_ptr<Ast>>>(
+                          std::move(script)))
+             .first;
   }
-  ptr_to_script_ = it;
-  this->index_ = index;
+  return *it->second;
+}
+
+void ScriptEngine::shareScripts(const ScriptEngine &other) {
+  for (auto &[file_name, script] : other.scripts_) {
+    scripts_.emplace(file_name, script);
+  }
+}
+
+void ScriptEngine::prefetch(const std::string &file_name) {
+  if (jobs == nullptr || scripts_.count(file_name) != 0 ||
+      pending_scripts_.count(file_name) != 0) {
+    return;
+  }
+  pending_scripts_.emplace(
+      file_name, jobs->submit("parse script", JobSystem::BACKGROUND,
+                              [prefix = script_dir_prefix, file_name] {
+                                return parse(prefix, file_name);
+                              }));
+}
+
+const std::string &ScriptEngine::currentScript() const {
+  static const std::string none;
+  return ptr_to_script_ == nullptr ? none : ptr_to_script_->first;
+}
+
+std::size_t ScriptEngine::position() const { return index_; }
+
+bool ScriptEngine::runnable() const {
+  return !blocked && ptr_to_script_ != nullptr &&
+         index_ < ptr_to_script_->second->size();
 }
 
 void ScriptEngine::run() {
-  if (blocked || ptr_to_script_->second.size() <= index_) {
+  if (!runnable()) {
     return;
   }
-  evaluate(ptr_to_script_->second[index_]);
+  evaluate((*ptr_to_script_->second)[index_]);
   ++index_;
 }
 
@@ -127,6 +186,33 @@ void ScriptEngine::registerCommand(const std::string &func_name,
   commands_[func_name] = func;
 }
 
+void ScriptEngine::registerAssetArgument(
+    const std::string &func_name, std::size_t index,
+    std::function<std::uint32_t(const std::string &)> resolver) {
+  asset_arguments_.emplace(func_name, std::make_pair(index, resolver));
+}
+
+void ScriptEngine::resolveAssets(
+    const std::vector<std::unique_ptr<Ast>> &script) {
+  for (auto &ast : script) {
+    if (ast->type() != Ast::COMMAND) {
+      continue;
+    }
+    auto ptr = dynamic_cast<CommandAst *>(ast.get());
+    auto [begin, end] = asset_arguments_.equal_range(ptr->command.value);
+    for (auto it = begin; it != end; ++it) {
+      auto &[index, resolver] = it->second;
+      if (index < ptr->args.size() &&
+          ptr->args[index]->type() == Ast::STRING) {
+        auto arg = dynamic_cast<StringAst *>(ptr->args[index].get());
+        arg->handle = resolver(arg->value);
+      }
+    }
+  }
+}
+
+std::size_t ScriptEngine::argc() const { return stack_.size(); }
+
 int ScriptEngine::popInt() {
   if (stack_.empty()) {
     throw std::runtime_error(fmt::format("too few arguments"));
@@ -155,12 +241,45 @@ std::string ScriptEngine::popString() {
   return ptr->getString();
 }
 
+std::u32string_view ScriptEngine::popText() {
+  if (stack_.empty()) {
+    throw std::runtime_error(fmt::format("too few arguments"));
+  }
+  std::unique_ptr<Object> ptr{stack_.top().release()};
+  stack_.pop();
+  if (ptr->type() != Object::STRING) {
+    throw std::runtime_error(fmt::format("expects {}, but received {}",
+                                         magic_enum::enum_name(Object::STRING),
+                                         magic_enum::enum_name(ptr->type())));
+  }
+  return ptr->getText();
+}
+
+std::uint32_t ScriptEngine::popHandle() {
+  if (stack_.empty()) {
+    throw std::runtime_error(fmt::format("too few arguments"));
+  }
+  std::unique_ptr<Object> ptr{stack_.top().release()};
+  stack_.pop();
+  if (ptr->type() != Object::STRING) {
+    throw std::runtime_error(fmt::format("expects {}, but received {}",
+                                         magic_enum::enum_name(Object::STRING),
+                                         magic_enum::enum_name(ptr->type())));
+  }
+  if (ptr->getHandle() == 0) {
+    throw std::runtime_error(
+        fmt::format("{}: unresolved asset", ptr->getString()));
+  }
+  return ptr->getHandle();
+}
+
 void ScriptEngine::pushInt(int value) {
   stack_.push(std::unique_ptr<Object>(new Integer{value}));
 }
 
-void ScriptEngine::pushString(const std::string &value) {
-  stack_.push(std::unique_ptr<Object>(new String{value}));
+void ScriptEngine::pushString(const StringAst &ast) {
+  stack_.push(
+      std::unique_ptr<Object>(new String{ast.value, ast.text, ast.handle}));
 }
 
 void ScriptEngine::evaluate(const std::unique_ptr<Ast> &ast) {
@@ -172,7 +291,7 @@ void ScriptEngine::evaluate(const std::unique_ptr<Ast> &ast) {
   }
   case Ast::STRING: {
     auto ptr = dynamic_cast<StringAst *>(ast.get());
-    pushString(ptr->value);
+    pushString(*ptr);
     break;
   }
   case Ast::IDENTIFIER: {
@@ -1,12 +1,16 @@
 #ifndef SAKURA_ELAINA_SCRIPT_ENGINE_H
 #define SAKURA_ELAINA_SCRIPT_ENGINE_H
 
+#include "../job_system.h"
 #include "ast.h"
 #include "object.h"
+#include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <memory>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 namespace sakura {
@@ -17,28 +21,68 @@ class ScriptEngine {
 public:
   ScriptEngine();
   void loadScript(const std::string &file_name, std::size_t index = 0);
+  // Parses the script if it is not cached yet, without running it.
+  const std::vector<std::unique_ptr<Ast>> &
+  compile(const std::string &file_name);
+  // Parses the script on a worker of `jobs` if it is not cached yet, so that
+  // `compile` only resolves its assets. Does nothing without `jobs`.
+  void prefetch(const std::string &file_name);
+  // Uses the scripts `other` has compiled without copying them, so that
+  // engines running on several threads share them read-only. `other` must
+  // not compile them again, asset arguments are resolved as it did.
+  void shareScripts(const ScriptEngine &other);
+  // Empty before any script is loaded.
+  const std::string &currentScript() const;
+  // The index of the command being run in the current script, or of the
+  // next one between two `run`s.
+  std::size_t position() const;
+  // Whether `run` would evaluate a command.
+  bool runnable() const;
   void run();
   void registerCommand(const std::string &func_name,
                        std::function<void(ScriptEngine &)> func);
+  // The string literal passed as the `index`-th argument of `func_name` is
+  // resolved to a handle by `resolver` once, when the script is loaded.
+  void registerAssetArgument(
+      const std::string &func_name, std::size_t index,
+      std::function<std::uint32_t(const std::string &)> resolver);
+  // The number of arguments the running command has not popped yet.
+  std::size_t argc() const;
   int popInt();
   std::string popString();
+  // Pops a string as decoded when the script was parsed, valid as long as
+  // the engine.
+  std::u32string_view popText();
+  // Pops a string argument registered by `registerAssetArgument`.
+  std::uint32_t popHandle();
 
 private:
   void pushInt(int value);
-  void pushString(const std::string &value);
+  void pushString(const StringAst &ast);
   void evaluate(const std::unique_ptr<Ast> &ast);
+  void resolveAssets(const std::vector<std::unique_ptr<Ast>> &script);
 
 public:
   std::filesystem::path script_dir_prefix;
+  JobSystem *jobs = nullptr;
   bool blocked = false;
   std::unordered_map<std::string, int> variables;
 
 private:
-  std::unordered_map<std::string, std::vector<std::unique_ptr<Ast>>> scripts_;
+  std::unordered_map<std::string,
+                     std::shared_ptr<std::vector<std::unique_ptr<Ast>>>>
+      scripts_;
+  std::unordered_map<std::string, Job<std::vector<std::unique_ptr<Ast>>>>
+      pending_scripts_;
   std::unordered_map<std::string, std::function<void(ScriptEngine &)>>
       commands_;
+  std::unordered_multimap<
+      std::string,
+      std::pair<std::size_t, std::function<std::uint32_t(const std::string &)>>>
+      asset_arguments_;
   std::stack<std::unique_ptr<Object>> stack_;
-  decltype(scripts_)::const_iterator ptr_to_script_;
+  // a pointer stays valid when `compile` rehashes `scripts_`
+  const decltype(scripts_)::value_type *ptr_to_script_ = nullptr;
   std::size_t index_ = -1;
 };
 
@@ -1,14 +1,42 @@
 #include "engine.h"
+#include "cooked_texture.h"
+#include "gpu_lock.h"
+#include "sdf_font.h"
+#include "utf8.h"
 #include "utility.h"
 #include <fmt/core.h>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <nlohmann/json.hpp>
 #include <stdexcept>
+#include <unordered_set>
 
 namespace sakura {
 
+namespace {
+
+// Adds the time until it is destroyed to `total`, in seconds.
+class PhaseTimer {
+public:
+  explicit PhaseTimer(double &total)
+      : total_(total), start_(std::chrono::steady_clock::now()) {}
+  ~PhaseTimer() {
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start_;
+    total_ += elapsed.count();
+  }
+
+private:
+  double &total_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace
+
 Engine::Engine(const std::filesystem::path &dir) {
   std::filesystem::current_path(dir);
+  script_engine_.jobs = &jobs_;
 
   script_engine_.registerCommand("say",
                                  std::function<void(elaina::ScriptEngine &)>{
@@ -16,81 +44,133 @@ Engine::Engine(const std::filesystem::path &dir) {
                                        if (scene_->main_dialog == nullptr) {
                                          // TODO: say something
                                        } else {
-                                         std::string msg = se.popString();
-                                         std::string name = se.popString();
-                                         scene_->main_dialog->setName(name);
-                                         scene_->main_dialog->setText(msg);
+                                         auto msg = se.popText();
+                                         auto name = se.popText();
+                                         scene_->say(name, msg, text_layouter_);
+                                         scheduler_.invalidate(
+                                             RenderScheduler::TEXT);
+                                         if (voice_ != INVALID_ASSET) {
+                                           audio_.playVoice(voice_);
+                                           voice_ = INVALID_ASSET;
+                                         } else {
+                                           audio_.stopVoice();
+                                         }
+                                         prefetchVoice(se.position() + 1);
                                          se.blocked = true;
                                        }
                                      }});
   script_engine_.registerCommand(
       "bgm", std::function<void(elaina::ScriptEngine &)>{
                  [this](elaina::ScriptEngine &se) {
-                   if (bgm_ != nullptr) {
-                     bgm_->pause();
-                   }
-                   bgm_ = resource_manager_.loadMusic(se.popString());
-                   bgm_->setLoop(true);
-                   bgm_->play();
+                   audio_.playBgm(se.popHandle());
                  }});
   script_engine_.registerCommand("pauseBgm",
                                  std::function<void(elaina::ScriptEngine &)>{
                                      [this](elaina::ScriptEngine &se) {
-                                       if (bgm_ != nullptr) {
-                                         bgm_->pause();
-                                       }
+                                       audio_.pauseBgm();
                                      }});
   script_engine_.registerCommand("stopBgm",
                                  std::function<void(elaina::ScriptEngine &)>{
                                      [this](elaina::ScriptEngine &se) {
-                                       if (bgm_ != nullptr) {
-                                         bgm_->stop();
-                                       }
+                                       audio_.stopBgm();
                                      }});
+  script_engine_.registerCommand("voice",
+                                 std::function<void(elaina::ScriptEngine &)>{
+                                     [this](elaina::ScriptEngine &se) {
+                                       voice_ = se.popHandle();
+                                       resource_manager_.prefetchSound(voice_);
+                                     }});
+  script_engine_.registerCommand(
+      "se", std::function<void(elaina::ScriptEngine &)>{
+                [this](elaina::ScriptEngine &se) {
+                  audio_.play(se.popHandle(), AudioSystem::EFFECT);
+                }});
   script_engine_.registerCommand(
       "background",
       std::function<void(elaina::ScriptEngine &)>{
           [this](elaina::ScriptEngine &se) {
-            background_.setTexture(
-                resource_manager_.loadTexture(se.popString()).get());
+            background_texture_ = resource_manager_.loadTexture(
+                se.popHandle(), design_size_);
+            scheduler_.invalidate(RenderScheduler::BACKGROUND);
           }});
   script_engine_.registerCommand(
       "addSprite",
       std::function<void(elaina::ScriptEngine &)>{
           [this](elaina::ScriptEngine &se) {
-            sf::Sprite sprite;
+            int z = se.argc() > 4 ? se.popInt() : 0;
             float top = static_cast<float>(se.popInt());
             float left = static_cast<float>(se.popInt());
-            std::string texture = se.popString();
+            auto texture = se.popHandle();
             std::string name = se.popString();
-            sprite.setTexture(*resource_manager_.loadTexture(texture));
-            sprite.setPosition({left, top});
-            sprites_.emplace(name, sprite);
+            auto ptr = resource_manager_.loadTexture(texture);
+            // the texture may be a downscaled tier, so draw it at the size of
+            // the source image
+            auto size = resource_manager_.designSize(texture);
+            sprites_.add(name, std::move(ptr), {left, top, size.x, size.y}, z);
+            scheduler_.invalidate(RenderScheduler::SPRITES);
           }});
   script_engine_.registerCommand("rmSprite",
                                  std::function<void(elaina::ScriptEngine &)>{
                                      [this](elaina::ScriptEngine &se) {
-                                       auto it = sprites_.find(se.popString());
-                                       if (it != sprites_.end()) {
-                                         sprites_.erase(it);
+                                       if (sprites_.remove(se.popString())) {
+                                         scheduler_.invalidate(
+                                             RenderScheduler::SPRITES);
                                        }
                                      }});
   script_engine_.registerCommand(
       "select", std::function<void(elaina::ScriptEngine &)>{
                     [this](elaina::ScriptEngine &se) {
                       auto second_action = se.popString();
-                      auto second_text = se.popString();
+                      auto second_text = se.popText();
                       auto first_action = se.popString();
-                      auto first_text = se.popString();
+                      auto first_text = se.popText();
                       scene_->select(first_text, first_action, second_text,
                                      second_action);
+                      scheduler_.invalidate(RenderScheduler::SCENE);
                       se.blocked = true;
                     }});
   script_engine_.registerCommand(
       "scene", std::function<void(elaina::ScriptEngine &)>{
                    [this](elaina::ScriptEngine &se) {
-                     scene_ = resource_manager_.loadScene(se.popString());
+                     scene_ = resource_manager_.loadScene(se.popHandle());
+                     if (scene_->main_dialog != nullptr) {
+                       scene_->main_dialog->text.speed = text_speed_;
+                       scene_->main_dialog->text.fade = text_fade_;
+                     }
+                     warmGlyphs(se.currentScript());
+                     scheduler_.invalidate(RenderScheduler::SCENE);
                    }});
+
+  for (auto &argument : ASSET_ARGUMENTS) {
+    std::function<std::uint32_t(const std::string &)> resolver;
+    switch (argument.kind) {
+    case AssetArgument::BACKGROUND:
+    case AssetArgument::SPRITE:
+      resolver = [this](const std::string &file_name) {
+        return resource_manager_.internTexture(file_name);
+      };
+      break;
+    case AssetArgument::MUSIC:
+      resolver = [this](const std::string &file_name) {
+        return resource_manager_.internMusic(file_name);
+      };
+      break;
+    case AssetArgument::SOUND:
+      resolver = [this](const std::string &file_name) {
+        return resource_manager_.internSound(file_name);
+      };
+      break;
+    case AssetArgument::SCENE:
+      resolver = [this](const std::string &file_name) {
+        return resource_manager_.internScene(file_name);
+      };
+      break;
+    case AssetArgument::SCRIPT:
+      continue;
+    }
+    script_engine_.registerAssetArgument(argument.command, argument.index,
+                                         std::move(resolver));
+  }
 }
 
 void Engine::run() {
@@ -100,14 +180,60 @@ void Engine::run() {
   // } catch (const std::exception &err) {
   //   this->error(err.what());
   // }
-  loadProject();
-  mainloop();
+  {
+    PhaseTimer timer(frame_stats_.phases[FrameStats::LOAD]);
+    loadProject();
+  }
+  if (!replay_path.empty()) {
+    replay_ = InputRecording::load(replay_path);
+    replaying_ = true;
+  }
+  if (headless) {
+    runHeadless();
+  } else {
+    mainloop();
+  }
+  if (!record_path.empty()) {
+    recording_.save(record_path);
+  }
 }
 
 void Engine::error(const std::string &msg) {
   // TODO
 }
 
+// sakura.json:
+// {
+//   "name": string,
+//   "window": {
+//     "width": number,
+//     "height": number,
+//     "design_width": <optional: width> number,
+//     "design_height": <optional: height> number,
+//     "icon": <optional> string,
+//     "vsync": <optional: true> boolean,
+//     "frame_limit": <optional: 60> number, used without vsync, 0 for none
+//     "render_thread": <optional: false> boolean, draws on another thread,
+//                      the logic then updates at frame_limit (or 60) Hz
+//   },
+//   "prefixes": <optional> {
+//     <asset kind>: string
+//   },
+//   "text": <optional> {
+//     "speed": <optional: 40> number, characters per second, 0 for instant
+//     "fade": <optional: 4> number, characters fading in at once
+//     "sdf": <optional: false> boolean, draws the dialog text from a distance
+//            field atlas, ignored without shader support
+//   },
+//   "audio": <optional> {
+//     "voices": <optional: 16> number, sounds playing at once
+//     "sound_budget": <optional: 64> number, MiB of cached sounds
+//   }
+// }
+//
+// Scripts, scenes and textures are authored in design units, which are
+// scaled to the window.
+
 void Engine::loadProject() {
   std::ifstream file("sakura.json");
   if (!file.is_open()) {
@@ -126,11 +252,35 @@ void Engine::loadProject() {
     auto window = config["window"];
     auto width = window["width"].get<unsigned>();
     auto height = window["height"].get<unsigned>();
-    window_.create(sf::VideoMode(width, height), utf8ToWstring(config["name"]),
-                   sf::Style::Titlebar | sf::Style::Close);
-    background_.setSize(
-        {static_cast<float>(width), static_cast<float>(height)});
-    if (window["icon"].is_string()) {
+    auto design_width = window.value("design_width", width);
+    auto design_height = window.value("design_height", height);
+    if (headless) {
+      if (!offscreen_.create(width, height)) {
+        throw std::runtime_error("can't create an offscreen render target");
+      }
+    } else {
+      window_.create(sf::VideoMode(width, height),
+                     toSfString(decodeUtf8(config["name"].get<std::string>())),
+                     sf::Style::Titlebar | sf::Style::Close);
+    }
+    target().setView(sf::View({0, 0, static_cast<float>(design_width),
+                               static_cast<float>(design_height)}));
+    resource_manager_.pixel_ratio =
+        std::min(static_cast<float>(width) / design_width,
+                 static_cast<float>(height) / design_height);
+    design_size_ = {static_cast<float>(design_width),
+                    static_cast<float>(design_height)};
+    if (headless || uncapped) {
+      // neither vsync nor a frame limit
+    } else if (window.value("vsync", true)) {
+      window_.setVerticalSyncEnabled(true);
+    } else {
+      window_.setFramerateLimit(window.value("frame_limit", 60u));
+    }
+    auto frame_limit = window.value("frame_limit", 60u);
+    tick_ = sf::seconds(1.0f / (frame_limit == 0 ? 60 : frame_limit));
+    render_thread_enabled_ = !headless && window.value("render_thread", false);
+    if (!headless && window["icon"].is_string()) {
       sf::Image icon;
       icon.loadFromFile(window["icon"]);
       window_.setIcon(icon.getSize().x, icon.getSize().y, icon.getPixelsPtr());
@@ -141,31 +291,254 @@ void Engine::loadProject() {
       resource_manager_.prefixes[prefix.key()] =
           std::filesystem::path{prefix.value()};
     }
-    script_engine_.script_dir_prefix = resource_manager_.prefixes["script"];
+    script_engine_.script_dir_prefix = resource_manager_.prefix("script");
+  }
+  if (config["text"].is_object()) {
+    text_speed_ = config["text"].value("speed", text_speed_);
+    text_fade_ = config["text"].value("fade", text_fade_);
+    if (config["text"].value("sdf", false) && SdfFont::shader() != nullptr) {
+      text_layouter_.sdf = [this](const sf::Font &font) {
+        return resource_manager_.fontBytes(font);
+      };
+    }
+  }
+  if (config["audio"].is_object()) {
+    auto audio = config["audio"];
+    audio_.setVoiceCount(audio.value("voices", std::size_t{16}));
+    resource_manager_.sound_budget =
+        audio.value("sound_budget", std::size_t{64}) << 20;
+  }
+  if (std::filesystem::exists("manifest.json")) {
+    resource_manager_.loadManifest("manifest.json");
   }
 
   script_engine_.loadScript("entry.ela");
 }
 
-void Engine::render() {
-  window_.draw(background_);
-  for (auto &[_, spirite] : sprites_) {
-    window_.draw(spirite);
+sf::RenderTarget &Engine::target() {
+  if (headless) {
+    return offscreen_;
+  }
+  return window_;
+}
+
+// Everything a frame does but input and drawing.
+void Engine::update(sf::Time elapsed) {
+  auto &phases = frame_stats_.phases;
+  {
+    PhaseTimer timer(phases[FrameStats::SCRIPT]);
+    script_engine_.run();
+  }
+  {
+    PhaseTimer timer(phases[FrameStats::AUDIO]);
+    audio_.update(elapsed);
+  }
+  if (scene_ != nullptr && scene_->revealing()) {
+    PhaseTimer timer(phases[FrameStats::ANIMATION]);
+    scene_->update(elapsed);
+    scheduler_.invalidate(RenderScheduler::ANIMATION);
+  }
+  if (&script_engine_.currentScript() != preloaded_script_) {
+    PhaseTimer timer(phases[FrameStats::PRELOAD]);
+    preloaded_script_ = &script_engine_.currentScript();
+    preload();
+  }
+  if (glyph_warmer_.pending()) {
+    PhaseTimer timer(phases[FrameStats::GLYPHS]);
+    if (headless || replaying_) {
+      // rasterizing within a time budget would depend on the machine
+      glyph_warmer_.finish();
+    } else {
+      glyph_warmer_.step(sf::milliseconds(2));
+    }
   }
+  {
+    PhaseTimer timer(phases[FrameStats::UPLOADS]);
+    jobs_.pump(sf::milliseconds(2));
+  }
+}
+
+void Engine::record(DrawList &list) {
+  PhaseTimer timer(frame_stats_.phases[FrameStats::RECORD]);
+  // compositing layers and laying out labels use textures and fonts the
+  // render thread may be drawing with
+  std::lock_guard lock(gpuMutex());
+  list.clear();
+  list.recorded = std::chrono::steady_clock::now();
+  sf::RenderStates states(BlendPremultipliedAlpha);
+  states.texture = background_texture_.get();
+  list.retain(background_texture_);
+  list.addRect({{0, 0}, design_size_}, states);
+  sprites_.record(list, BlendPremultipliedAlpha);
   if (scene_ != nullptr) {
-    scene_->render(window_);
+    list.retain(scene_);
+    scene_->record(list, target(), scene_layers_);
+  }
+}
+
+// Draws `list` and blocks for vsync or the frame limit.
+void Engine::present(const DrawList &list) {
+  PhaseTimer timer(frame_stats_.phases[FrameStats::PRESENT]);
+  {
+    std::lock_guard lock(gpuMutex());
+    target().clear();
+    list.draw(target());
+  }
+  if (headless) {
+    offscreen_.display();
+  } else {
+    window_.display();
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  std::chrono::duration<double> latency = now - list.recorded;
+  std::chrono::duration<double> interval = now - last_present_;
+  frame_stats_.presented(latency.count(), frame_stats_.frames == 0
+                                              ? -1.0
+                                              : interval.count());
+  last_present_ = now;
+}
+
+void Engine::renderLoop() {
+  window_.setActive(true);
+  std::uint64_t seen = 0;
+  while (true) {
+    published_.wait(seen);
+    seen = published_.load();
+    if (quit_) {
+      break;
+    }
+    if (snapshots_.acquire()) {
+      present(snapshots_.front());
+    }
+  }
+  window_.setActive(false);
+}
+
+void Engine::stopRendering() {
+  if (render_thread_.joinable()) {
+    quit_ = true;
+    ++published_;
+    published_.notify_one();
+    render_thread_.join();
+    window_.setActive(true);
+  }
+}
+
+sf::Event Engine::mapToView(const sf::Event &event) const {
+  auto mapped = event;
+  switch (event.type) {
+  case sf::Event::MouseButtonPressed:
+  case sf::Event::MouseButtonReleased: {
+    auto position = window_.mapPixelToCoords(
+        {event.mouseButton.x, event.mouseButton.y});
+    mapped.mouseButton.x = static_cast<int>(position.x);
+    mapped.mouseButton.y = static_cast<int>(position.y);
+    break;
+  }
+  case sf::Event::MouseMoved: {
+    auto position =
+        window_.mapPixelToCoords({event.mouseMove.x, event.mouseMove.y});
+    mapped.mouseMove.x = static_cast<int>(position.x);
+    mapped.mouseMove.y = static_cast<int>(position.y);
+    break;
+  }
+  default:
+    break;
+  }
+  return mapped;
+}
+
+// Restarts the delay whenever the script moves on.
+void Engine::advanceStamp(sf::Time elapsed) {
+  const auto *script = &script_engine_.currentScript();
+  auto position = script_engine_.position();
+  if (script != stamp_script_ || position != stamp_position_) {
+    stamp_script_ = script;
+    stamp_position_ = position;
+    stamp_delay_ = sf::Time::Zero;
+  } else {
+    stamp_delay_ += elapsed;
+  }
+}
+
+void Engine::input() {
+  PhaseTimer timer(frame_stats_.phases[FrameStats::INPUT]);
+  sf::Event event;
+  while (!headless && window_.pollEvent(event)) {
+    // the window can still be closed while replaying
+    if (!replaying_ || event.type == sf::Event::Closed) {
+      consume(mapToView(event));
+    }
+  }
+  if (!replaying_) {
+    return;
+  }
+
+  while (auto due = replay_.due(*stamp_script_, stamp_position_,
+                                stamp_delay_)) {
+    auto replayed = *due;
+    replay_.pop();
+    consume(replayed);
+  }
+  // the script waits for input
+  if (script_engine_.runnable() ||
+      (scene_ != nullptr && scene_->revealing())) {
+    return;
+  }
+  auto next = replay_.next();
+  if (next == nullptr) {
+    quit_ = true;
+  } else if (next->script != *stamp_script_ ||
+             next->position != stamp_position_) {
+    throw std::runtime_error(fmt::format(
+        "{}: replay diverged, waiting at {}:{} for input recorded at {}:{}",
+        replay_path.string(), *stamp_script_, stamp_position_, next->script,
+        next->position));
   }
 }
 
+void Engine::consume(const sf::Event &event) {
+  if (!record_path.empty()) {
+    recording_.add({*stamp_script_, stamp_position_, stamp_delay_}, event);
+  }
+  handle(event);
+}
+
 void Engine::handle(const sf::Event &event) {
   switch (event.type) {
   case sf::Event::Closed:
-    window_.close();
+    quit_ = true;
+    break;
+  case sf::Event::Resized:
+    scheduler_.invalidate(RenderScheduler::WINDOW);
+    break;
+  case sf::Event::GainedFocus:
+    scheduler_.setFocused(true);
+    break;
+  case sf::Event::LostFocus:
+    scheduler_.setFocused(false);
+    break;
+  case sf::Event::MouseMoved:
+    if (scene_ != nullptr &&
+        scene_->hover({static_cast<float>(event.mouseMove.x),
+                       static_cast<float>(event.mouseMove.y)})) {
+      scheduler_.invalidate(RenderScheduler::SCENE);
+    }
+    break;
+  case sf::Event::MouseButtonReleased:
+    if (scene_ != nullptr && scene_->release()) {
+      scheduler_.invalidate(RenderScheduler::SCENE);
+    }
     break;
   case sf::Event::MouseButtonPressed: {
-    auto action = scene_->on(event);
+    scheduler_.invalidate(RenderScheduler::SCENE);
+    auto action = scene_->press({static_cast<float>(event.mouseButton.x),
+                                 static_cast<float>(event.mouseButton.y)});
     if (action.empty()) {
-      if (!scene_->selected) {
+      if (scene_->revealing()) {
+        scene_->completeReveal();
+      } else if (!scene_->selected) {
         script_engine_.blocked = false;
       }
     } else {
@@ -178,7 +551,10 @@ void Engine::handle(const sf::Event &event) {
     switch (event.key.code) {
     case sf::Keyboard::Space:
     case sf::Keyboard::Enter:
-      if (!scene_->selected) {
+      scheduler_.invalidate(RenderScheduler::TEXT);
+      if (scene_->revealing()) {
+        scene_->completeReveal();
+      } else if (!scene_->selected) {
         script_engine_.blocked = false;
       }
       break;
@@ -191,16 +567,180 @@ void Engine::handle(const sf::Event &event) {
   }
 }
 
+// Called when another script starts: unloads what can't be used anymore and
+// prefetches what this script and the next ones will show.
+void Engine::preload() {
+  const auto &current = script_engine_.currentScript();
+  const auto &manifest = asset_manifest_.script(current);
+  // `reachable` parses the successors, start them all at once
+  for (auto &successor : manifest.successors) {
+    script_engine_.prefetch(successor);
+  }
+  resource_manager_.retain(asset_manifest_.reachable(current));
+  prefetch(manifest);
+  for (auto &successor : manifest.successors) {
+    prefetch(asset_manifest_.script(successor));
+  }
+  prefetchVoice(script_engine_.position());
+  warmGlyphs(current);
+}
+
+// The glyphs of the current script are rasterized at once, those of the
+// scripts reachable from it a few per frame.
+void Engine::warmGlyphs(const std::string &script) {
+  if (scene_ == nullptr || scene_->main_dialog == nullptr) {
+    return;
+  }
+  auto &glyphs = text_layouter_.glyphs(
+      scene_->font, scene_->main_dialog->text.getCharacterSize());
+  glyph_warmer_.warm(glyphs, asset_manifest_.script(script).code_points);
+  glyph_warmer_.enqueue(glyphs, asset_manifest_.reachableCodePoints(script));
+}
+
+void Engine::prefetch(const ScriptManifest &manifest) {
+  for (auto id : manifest.backgrounds) {
+    resource_manager_.prefetchTexture(id, design_size_);
+  }
+  for (auto id : manifest.sprites) {
+    resource_manager_.prefetchTexture(id);
+  }
+  for (auto id : manifest.scenes) {
+    try {
+      resource_manager_.prefetchScene(id);
+    } catch (const std::exception &) {
+      // reported by @scene
+    }
+  }
+}
+
+// Decodes the voice of the next line while the current one is shown, so that
+// it starts in the same frame as its @say.
+void Engine::prefetchVoice(std::size_t from) {
+  const auto &script = script_engine_.compile(script_engine_.currentScript());
+  for (auto i = from; i < script.size(); ++i) {
+    if (script[i]->type() != elaina::Ast::COMMAND) {
+      continue;
+    }
+    auto command = dynamic_cast<const elaina::CommandAst *>(script[i].get());
+    if (command->command.value == "say") {
+      return;
+    }
+    if (command->command.value == "voice" && !command->args.empty() &&
+        command->args[0]->type() == elaina::Ast::STRING) {
+      auto arg = dynamic_cast<const elaina::StringAst *>(command->args[0].get());
+      resource_manager_.prefetchSound(arg->handle);
+      return;
+    }
+  }
+}
+
+void FrameStats::presented(double latency, double interval) {
+  ++frames;
+  latency_mean += (latency - latency_mean) / frames;
+  latency_max = std::max(latency_max, latency);
+  if (interval < 0) {
+    return;
+  }
+  // Welford's online variance
+  ++intervals_;
+  auto delta = interval - interval_mean;
+  interval_mean += delta / intervals_;
+  interval_m2_ += delta * (interval - interval_mean);
+  jitter = std::sqrt(interval_m2_ / intervals_);
+}
+
+const FrameStats &Engine::frameStats() const { return frame_stats_; }
+
+const JobSystem &Engine::jobSystem() const { return jobs_; }
+
+// With a render thread the logic runs at the frame rate and hands over
+// snapshots of the frame, display and vsync then never stall it.
 void Engine::mainloop() {
-  while (window_.isOpen()) {
-    sf::Event event;
-    while (window_.pollEvent(event)) {
-      handle(event);
+  if (render_thread_enabled_) {
+    window_.setActive(false);
+    render_thread_ = std::thread(&Engine::renderLoop, this);
+  }
+  sf::Clock clock;
+  sf::Clock run_time;
+  while (!quit_) {
+    if (time_limit != sf::Time::Zero &&
+        run_time.getElapsedTime() >= time_limit) {
+      break;
+    }
+    ++frame_stats_.iterations;
+    sf::Clock tick;
+    bool drawn = false;
+    auto elapsed = clock.restart();
+    if (replaying_) {
+      elapsed = frame_step;
+    }
+    advanceStamp(elapsed);
+    input();
+    update(elapsed);
+    if (scheduler_.dirty()) {
+      if (render_thread_.joinable()) {
+        record(snapshots_.back());
+        snapshots_.publish();
+        ++published_;
+        published_.notify_one();
+      } else {
+        record(draw_list_);
+        present(draw_list_);
+      }
+      scheduler_.presented();
+      drawn = true;
+    }
+    if (replaying_ && uncapped) {
+      // neither pace nor sleep
+    } else if (drawn) {
+      if (render_thread_.joinable()) {
+        sf::sleep(tick_ - tick.getElapsedTime());
+      }
+    } else if (!script_engine_.runnable() && !glyph_warmer_.pending() &&
+               !jobs_.hasMainTasks()) {
+      // SFML 2 has no waitEvent with a timeout, poll again after a while
+      sf::sleep(scheduler_.idleTimeout());
+      ++frame_stats_.idle;
+    }
+  }
+  stopRendering();
+  window_.close();
+}
+
+void Engine::runHeadless() {
+  std::unordered_set<std::size_t> dumps(dump_frames.begin(),
+                                        dump_frames.end());
+  if (!dumps.empty()) {
+    std::filesystem::create_directories(dump_dir);
+  }
+  frame_stats_.timings.reserve(frame_count);
+  // a replay runs until all of it has been replayed
+  for (std::size_t frame = 0;
+       !quit_ && (replaying_ || frame < frame_count); ++frame) {
+    ++frame_stats_.iterations;
+    sf::Clock clock;
+    advanceStamp(frame_step);
+    input();
+    update(frame_step);
+    FrameTiming timing;
+    timing.update = clock.restart().asSeconds();
+    if (scheduler_.dirty()) {
+      record(draw_list_);
+      present(draw_list_);
+      scheduler_.presented();
+      timing.render = clock.restart().asSeconds();
+      timing.drawn = true;
+    }
+    frame_stats_.timings.push_back(timing);
+
+    // the texture keeps the last frame drawn
+    if (dumps.count(frame) != 0) {
+      auto path = dump_dir / fmt::format("frame_{}.png", frame);
+      if (!offscreen_.getTexture().copyToImage().saveToFile(path.string())) {
+        throw std::runtime_error(
+            fmt::format("{}: can't save frame", path.string()));
+      }
     }
-    script_engine_.run();
-    window_.clear();
-    render();
-    window_.display();
   }
 }
 
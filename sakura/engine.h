@@ -1,37 +1,184 @@
 #ifndef SAKURA_ENGINE_H
 #define SAKURA_ENGINE_H
 
+#include "asset_manifest.h"
+#include "audio.h"
+#include "draw_list.h"
 #include "elaina/script_engine.h"
+#include "glyph_warmer.h"
+#include "input_recording.h"
+#include "job_system.h"
+#include "render_scheduler.h"
 #include "resource_manager.h"
 #include "scene.h"
+#include "sprite_layer.h"
+#include "triple_buffer.h"
 #include <SFML/Graphics.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace sakura {
 
+struct FrameTiming {
+  // CPU time in seconds, the GPU may still be drawing. `render` is 0 if
+  // nothing changed.
+  double update = 0;
+  double render = 0;
+  bool drawn = false;
+};
+
+struct FrameStats {
+  enum Phase {
+    // loading the project and the entry script
+    LOAD,
+    INPUT,
+    SCRIPT,
+    AUDIO,
+    // revealing text
+    ANIMATION,
+    // unloading and prefetching when another script starts
+    PRELOAD,
+    GLYPHS,
+    // of prefetched textures
+    UPLOADS,
+    RECORD,
+    // drawing and displaying, blocks for vsync or the frame limit
+    PRESENT,
+    PHASE_COUNT
+  };
+  static constexpr std::array<const char *, PHASE_COUNT> PHASE_NAMES = {
+      "load",    "input",  "script",  "audio",  "animation",
+      "preload", "glyphs", "uploads", "record", "present"};
+
+  // iterations of the main loop
+  std::size_t iterations = 0;
+  // frames rendered and presented
+  std::size_t frames = 0;
+  // iterations spent sleeping
+  std::size_t idle = 0;
+  // from recording a frame until its display returned, in seconds
+  double latency_mean = 0;
+  double latency_max = 0;
+  // between the displays of consecutive frames, in seconds
+  double interval_mean = 0;
+  // standard deviation of the interval
+  double jitter = 0;
+  // of every frame, only when headless
+  std::vector<FrameTiming> timings;
+  // total time spent in each phase, in seconds
+  std::array<double, PHASE_COUNT> phases{};
+
+  // `interval` is negative for the first frame.
+  void presented(double latency, double interval);
+
+private:
+  std::size_t intervals_ = 0;
+  double interval_m2_ = 0;
+};
+
 class Engine {
 public:
   Engine(const std::filesystem::path &dir);
   void run();
+  const FrameStats &frameStats() const;
+  const JobSystem &jobSystem() const;
+
+public:
+  // stop after this long, 0 runs until the window is closed
+  sf::Time time_limit;
+  // Renders offscreen instead of into a window, without input: runs
+  // `frame_count` frames as fast as possible, each advancing the clock by
+  // `frame_step`, so that every run shows the same frames.
+  bool headless = false;
+  std::size_t frame_count = 600;
+  sf::Time frame_step = sf::seconds(1.0f / 60);
+  // headless frames saved as <dump_dir>/frame_<index>.png
+  std::vector<std::size_t> dump_frames;
+  std::filesystem::path dump_dir;
+  // Saves the input consumed to this file when the engine stops, see
+  // `InputRecording`.
+  std::filesystem::path record_path;
+  // Replays the input recorded in this file instead of reading the window,
+  // and stops once all of it has been replayed. The clock advances by
+  // `frame_step` per frame, so the script sees the same times on every run.
+  std::filesystem::path replay_path;
+  // Runs without vsync or a frame limit, and replays without ever sleeping.
+  bool uncapped = false;
 
 private:
   void error(const std::string &msg);
   void loadProject();
-  void render();
+  sf::RenderTarget &target();
+  void update(sf::Time elapsed);
+  void record(DrawList &list);
+  void present(const DrawList &list);
+  void renderLoop();
+  sf::Event mapToView(const sf::Event &event) const;
+  void advanceStamp(sf::Time elapsed);
+  void input();
+  void consume(const sf::Event &event);
   void handle(const sf::Event &event);
+  void preload();
+  void prefetch(const ScriptManifest &manifest);
+  void prefetchVoice(std::size_t from);
+  void warmGlyphs(const std::string &script);
   void mainloop();
+  void runHeadless();
+  void stopRendering();
 
 private:
   sf::RenderWindow window_;
+  // drawn on instead of the window when headless
+  sf::RenderTexture offscreen_;
+  RenderScheduler scheduler_;
+  FrameStats frame_stats_;
+  std::chrono::steady_clock::time_point last_present_;
+  // the frame when drawing on this thread
+  DrawList draw_list_;
+  // Frames for the render thread, which copy or keep alive everything they
+  // draw. See `gpuMutex` for what the two threads still share.
+  bool render_thread_enabled_ = false;
+  TripleBuffer<DrawList> snapshots_;
+  std::atomic<std::uint64_t> published_{0};
+  std::thread render_thread_;
+  std::atomic<bool> quit_{false};
+  InputRecording recording_;
+  InputRecording replay_;
+  bool replaying_ = false;
+  // where the script is and since when, see `InputStamp`
+  const std::string *stamp_script_ = nullptr;
+  std::size_t stamp_position_ = 0;
+  sf::Time stamp_delay_;
+  // interval of the logic thread when it does not draw itself
+  sf::Time tick_ = sf::seconds(1.0f / 60);
+  // destroyed after the members below, queued tasks may refer to them
+  JobSystem jobs_;
   elaina::ScriptEngine script_engine_;
-  ResourceManager resource_manager_;
-  std::unordered_map<std::string, sf::Sprite> sprites_;
-  std::shared_ptr<sf::Music> bgm_;
-  sf::RectangleShape background_;
+  ResourceManager resource_manager_{jobs_};
+  AssetManifest asset_manifest_{script_engine_, resource_manager_};
+  // the script `preload` has run for
+  const std::string *preloaded_script_ = nullptr;
+  SpriteLayer sprites_;
+  AudioSystem audio_{resource_manager_};
+  TextLayouter text_layouter_;
+  GlyphWarmer glyph_warmer_;
+  float text_speed_ = 40.0f;
+  float text_fade_ = 4.0f;
+  // played by the next @say
+  AssetId voice_ = INVALID_ASSET;
+  sf::Vector2f design_size_;
+  std::shared_ptr<sf::Texture> background_texture_;
   std::shared_ptr<Scene> scene_;
+  // composites of `scene_`, kept across scene switches
+  Scene::Layers scene_layers_;
 };
 
 } // namespace sakura
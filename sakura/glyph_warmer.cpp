@@ -0,0 +1,77 @@
+#include "glyph_warmer.h"
+
+namespace sakura {
+
+namespace {
+
+// glyphs between two looks at the clock
+constexpr std::size_t BATCH_SIZE = 8;
+
+} // namespace
+
+void GlyphWarmer::enqueue(GlyphSource &glyphs,
+                          const std::vector<char32_t> &code_points) {
+  auto &queued = queued_[&glyphs];
+  std::vector<char32_t> added;
+  for (auto code_point : code_points) {
+    if (queued.insert(code_point).second && !glyphs.contains(code_point)) {
+      added.push_back(code_point);
+    }
+  }
+  if (!added.empty()) {
+    jobs_.push_back({&glyphs, std::move(added)});
+  }
+}
+
+void GlyphWarmer::warm(GlyphSource &glyphs,
+                       const std::vector<char32_t> &code_points) {
+  batch_.clear();
+  for (auto code_point : code_points) {
+    if (!glyphs.contains(code_point)) {
+      batch_.push_back(code_point);
+    }
+  }
+  glyphs.prepare(batch_.data(), batch_.data() + batch_.size());
+  warmed_ += batch_.size();
+}
+
+bool GlyphWarmer::warmBatch() {
+  if (jobs_.empty()) {
+    return false;
+  }
+  auto &job = jobs_.front();
+  batch_.clear();
+  for (; job.next < job.code_points.size() && batch_.size() < BATCH_SIZE;
+       ++job.next) {
+    auto code_point = job.code_points[job.next];
+    if (!job.glyphs->contains(code_point)) {
+      batch_.push_back(code_point);
+    }
+  }
+  job.glyphs->prepare(batch_.data(), batch_.data() + batch_.size());
+  warmed_ += batch_.size();
+  if (job.next == job.code_points.size()) {
+    jobs_.pop_front();
+  }
+  return true;
+}
+
+void GlyphWarmer::finish() {
+  while (warmBatch()) {
+  }
+}
+
+void GlyphWarmer::step(sf::Time budget) {
+  sf::Clock clock;
+  while (warmBatch()) {
+    if (clock.getElapsedTime() >= budget) {
+      break;
+    }
+  }
+}
+
+bool GlyphWarmer::pending() const { return !jobs_.empty(); }
+
+std::size_t GlyphWarmer::warmed() const { return warmed_; }
+
+} // namespace sakura
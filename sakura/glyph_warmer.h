@@ -0,0 +1,54 @@
+#ifndef SAKURA_GLYPH_WARMER_H
+#define SAKURA_GLYPH_WARMER_H
+
+#include "text_layout.h"
+#include <SFML/System.hpp>
+#include <cstddef>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace sakura {
+
+// Rasterizes glyphs before the frame they are first shown on. sf::Font
+// uploads glyphs to a texture, so this runs on the main thread, either at
+// once or a few glyphs per frame. Glyphs are prepared in small batches, so
+// that a distance field atlas reads the font texture back once per batch.
+class GlyphWarmer {
+public:
+  // Queues the code points which have not been queued for `glyphs` before,
+  // so that queueing a growing set only adds what is new. `glyphs` must
+  // outlive the warmer.
+  void enqueue(GlyphSource &glyphs, const std::vector<char32_t> &code_points);
+  // Rasterizes `code_points` at once, leaving the queue as it is.
+  void warm(GlyphSource &glyphs, const std::vector<char32_t> &code_points);
+  // Rasterizes everything queued.
+  void finish();
+  // Rasterizes queued glyphs for about `budget`.
+  void step(sf::Time budget);
+  bool pending() const;
+  // glyphs rasterized so far, not counting those which already were
+  std::size_t warmed() const;
+
+private:
+  struct Job {
+    GlyphSource *glyphs;
+    std::vector<char32_t> code_points;
+    std::size_t next = 0;
+  };
+
+  // Returns false if nothing was queued.
+  bool warmBatch();
+
+private:
+  std::deque<Job> jobs_;
+  std::unordered_map<const GlyphSource *, std::unordered_set<char32_t>>
+      queued_;
+  std::vector<char32_t> batch_;
+  std::size_t warmed_ = 0;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_GLYPH_WARMER_H
@@ -0,0 +1,10 @@
+#include "gpu_lock.h"
+
+namespace sakura {
+
+std::mutex &gpuMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+} // namespace sakura
@@ -0,0 +1,17 @@
+#ifndef SAKURA_GPU_LOCK_H
+#define SAKURA_GPU_LOCK_H
+
+#include <mutex>
+
+namespace sakura {
+
+// Held by the render thread while it draws a frame, and by the logic thread
+// while it changes what a recorded frame may draw: rasterizing glyphs into a
+// font page or atlas, which also covers any other use of a font, and
+// compositing cached layers. New textures need no lock, no frame refers to
+// them before they are recorded.
+std::mutex &gpuMutex();
+
+} // namespace sakura
+
+#endif // !SAKURA_GPU_LOCK_H
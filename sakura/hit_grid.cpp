@@ -0,0 +1,100 @@
+#include "hit_grid.h"
+#include "utility.h"
+#include <algorithm>
+#include <cmath>
+
+namespace sakura {
+
+namespace {
+
+constexpr unsigned MAX_CELLS_PER_SIDE = 64;
+
+bool isEmpty(const sf::FloatRect &rect) {
+  return rect.width <= 0 || rect.height <= 0;
+}
+
+} // namespace
+
+void HitGrid::build(std::vector<sf::FloatRect> rects) {
+  rects_ = std::move(rects);
+  bounds_ = {};
+  for (auto &rect : rects_) {
+    bounds_ = unite(bounds_, rect);
+  }
+  starts_.clear();
+  items_.clear();
+  if (isEmpty(bounds_)) {
+    columns_ = rows_ = 0;
+    return;
+  }
+
+  // about one cell per rectangle, roughly square
+  auto count = static_cast<float>(rects_.size());
+  auto aspect = bounds_.width / bounds_.height;
+  columns_ = std::clamp(
+      static_cast<unsigned>(std::ceil(std::sqrt(count * aspect))), 1u,
+      MAX_CELLS_PER_SIDE);
+  rows_ = std::clamp(static_cast<unsigned>(std::ceil(count / columns_)), 1u,
+                     MAX_CELLS_PER_SIDE);
+  cell_size_ = {bounds_.width / columns_, bounds_.height / rows_};
+
+  // counting sort into cells, from the top so that each cell lists the
+  // topmost first
+  starts_.assign(std::size_t{columns_} * rows_ + 1, 0);
+  for (auto &rect : rects_) {
+    if (isEmpty(rect)) {
+      continue;
+    }
+    auto range = cells(rect);
+    for (auto y = range.top; y <= range.bottom; ++y) {
+      for (auto x = range.left; x <= range.right; ++x) {
+        ++starts_[y * columns_ + x + 1];
+      }
+    }
+  }
+  for (std::size_t i = 1; i < starts_.size(); ++i) {
+    starts_[i] += starts_[i - 1];
+  }
+  items_.resize(starts_.back());
+  auto next = starts_;
+  for (auto i = static_cast<std::uint32_t>(rects_.size()); i-- > 0;) {
+    if (isEmpty(rects_[i])) {
+      continue;
+    }
+    auto range = cells(rects_[i]);
+    for (auto y = range.top; y <= range.bottom; ++y) {
+      for (auto x = range.left; x <= range.right; ++x) {
+        items_[next[y * columns_ + x]++] = i;
+      }
+    }
+  }
+}
+
+std::uint32_t HitGrid::find(sf::Vector2f point) const {
+  if (columns_ == 0 || !bounds_.contains(point)) {
+    return NONE;
+  }
+  auto range = cells({point.x, point.y, 0.0f, 0.0f});
+  auto cell = range.top * columns_ + range.left;
+  for (auto i = starts_[cell]; i < starts_[cell + 1]; ++i) {
+    if (rects_[items_[i]].contains(point)) {
+      return items_[i];
+    }
+  }
+  return NONE;
+}
+
+HitGrid::CellRange HitGrid::cells(const sf::FloatRect &rect) const {
+  auto column = [&](float x) {
+    return std::min(columns_ - 1, static_cast<unsigned>(std::max(
+                                      0.0f, (x - bounds_.left) / cell_size_.x)));
+  };
+  auto row = [&](float y) {
+    return std::min(rows_ - 1, static_cast<unsigned>(std::max(
+                                   0.0f, (y - bounds_.top) / cell_size_.y)));
+  };
+  return {column(rect.left), row(rect.top), column(rect.left + rect.width),
+          row(rect.top + rect.height)};
+}
+
+} // namespace sakura
@@ -0,0 +1,43 @@
+#ifndef SAKURA_HIT_GRID_H
+#define SAKURA_HIT_GRID_H
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace sakura {
+
+// Finds the topmost rectangle under a point. Rectangles are bucketed into a
+// uniform grid of about one cell per rectangle, so a lookup only tests the
+// few sharing the cell of the point.
+class HitGrid {
+public:
+  static constexpr std::uint32_t NONE = UINT32_MAX;
+
+  // Later rectangles are on top, empty ones are never hit.
+  void build(std::vector<sf::FloatRect> rects);
+  // The index of the topmost rectangle containing `point`, or NONE.
+  std::uint32_t find(sf::Vector2f point) const;
+
+private:
+  struct CellRange {
+    unsigned left, top, right, bottom;
+  };
+
+  CellRange cells(const sf::FloatRect &rect) const;
+
+private:
+  std::vector<sf::FloatRect> rects_;
+  sf::FloatRect bounds_;
+  sf::Vector2f cell_size_;
+  unsigned columns_ = 0;
+  unsigned rows_ = 0;
+  // the rectangles of cell i are items_[starts_[i], starts_[i + 1]), topmost
+  // first
+  std::vector<std::uint32_t> starts_;
+  std::vector<std::uint32_t> items_;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_HIT_GRID_H
@@ -0,0 +1,104 @@
+#include "image_scaling.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SAKURA_HAS_SSE2
+#endif
+
+namespace sakura {
+
+namespace {
+
+constexpr unsigned MAX_TIER = 4;
+
+inline void averagePixel(const std::uint8_t *a0, const std::uint8_t *a1,
+                         const std::uint8_t *b0, const std::uint8_t *b1,
+                         std::uint8_t *out) {
+  for (int c = 0; c < 4; ++c) {
+    out[c] = static_cast<std::uint8_t>((a0[c] + a1[c] + b0[c] + b1[c] + 2) >> 2);
+  }
+}
+
+// Two output pixels per iteration: four source pixels of both rows are
+// widened to 16 bits, summed vertically, then horizontally by pairs.
+std::size_t halveRow(const std::uint8_t *row0, const std::uint8_t *row1,
+                     std::uint8_t *out, std::size_t out_width) {
+  std::size_t x = 0;
+#ifdef SAKURA_HAS_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i two = _mm_set1_epi16(2);
+  for (; x + 2 <= out_width; x += 2) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + x * 8));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + x * 8));
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                               _mm_unpacklo_epi8(b, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                               _mm_unpackhi_epi8(b, zero));
+    __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi),
+                                _mm_unpackhi_epi64(lo, hi));
+    sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + x * 4),
+                     _mm_packus_epi16(sum, sum));
+  }
+#endif
+  return x;
+}
+
+} // namespace
+
+void halveImage(const std::uint8_t *src, sf::Vector2u size,
+                std::vector<std::uint8_t> &dst) {
+  auto out_width = std::max(1u, (size.x + 1) / 2);
+  auto out_height = std::max(1u, (size.y + 1) / 2);
+  std::size_t stride = std::size_t{size.x} * 4;
+  dst.resize(std::size_t{out_width} * out_height * 4);
+
+  // pairs which are complete in the source, the odd column is done below
+  std::size_t full_width = size.x / 2;
+  for (unsigned y = 0; y < out_height; ++y) {
+    const auto *row0 = src + std::size_t{2 * y} * stride;
+    const auto *row1 = 2 * y + 1 < size.y ? row0 + stride : row0;
+    auto *out = dst.data() + std::size_t{y} * out_width * 4;
+
+    auto x = halveRow(row0, row1, out, full_width);
+    for (; x < out_width; ++x) {
+      auto x0 = 2 * x;
+      auto x1 = std::min<std::size_t>(x0 + 1, size.x - 1);
+      averagePixel(row0 + x0 * 4, row0 + x1 * 4, row1 + x0 * 4, row1 + x1 * 4,
+                   out + x * 4);
+    }
+  }
+}
+
+sf::Vector2u downscaleImage(std::vector<std::uint8_t> &pixels,
+                            sf::Vector2u size, unsigned tier) {
+  std::vector<std::uint8_t> buffer;
+  for (unsigned i = 0; i < tier && (size.x > 1 || size.y > 1); ++i) {
+    halveImage(pixels.data(), size, buffer);
+    pixels.swap(buffer);
+    size = {std::max(1u, (size.x + 1) / 2), std::max(1u, (size.y + 1) / 2)};
+  }
+  return size;
+}
+
+unsigned selectTier(sf::Vector2u source_size, sf::Vector2f display_size,
+                    float pixel_ratio) {
+  if (source_size.x == 0 || source_size.y == 0) {
+    return 0;
+  }
+  float scale = pixel_ratio;
+  if (display_size.x > 0 && display_size.y > 0) {
+    scale *= std::max(display_size.x / source_size.x,
+                      display_size.y / source_size.y);
+  }
+  if (scale >= 0.5f) {
+    return 0;
+  }
+  auto tier = static_cast<unsigned>(std::floor(std::log2(1.0f / scale)));
+  return std::min(tier, MAX_TIER);
+}
+
+} // namespace sakura
@@ -0,0 +1,28 @@
+#ifndef SAKURA_IMAGE_SCALING_H
+#define SAKURA_IMAGE_SCALING_H
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace sakura {
+
+// Halves an RGBA8 image with a 2x2 box filter. Odd sizes round up, the last
+// column/row is then averaged with itself.
+void halveImage(const std::uint8_t *src, sf::Vector2u size,
+                std::vector<std::uint8_t> &dst);
+
+// Halves an image `tier` times in place, which is the `tier`-th mip level.
+sf::Vector2u downscaleImage(std::vector<std::uint8_t> &pixels,
+                            sf::Vector2u size, unsigned tier);
+
+// The coarsest tier which is still at least as large as the image on screen.
+// `display_size` is the size on screen in design units, {0, 0} means the
+// native size of the image, and `pixel_ratio` is the number of window pixels
+// per design unit.
+unsigned selectTier(sf::Vector2u source_size, sf::Vector2f display_size,
+                    float pixel_ratio);
+
+} // namespace sakura
+
+#endif // !SAKURA_IMAGE_SCALING_H
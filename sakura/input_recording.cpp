@@ -0,0 +1,153 @@
+#include "input_recording.h"
+#include <fmt/core.h>
+#include <fstream>
+#include <magic_enum.hpp>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+namespace sakura {
+
+namespace {
+
+constexpr int INPUT_RECORDING_VERSION = 1;
+
+nlohmann::json toJson(const InputStamp &stamp, const sf::Event &event) {
+  nlohmann::json json{
+      {"script", stamp.script},
+      {"position", stamp.position},
+      {"delay", stamp.delay.asMicroseconds()},
+      {"type", std::string(magic_enum::enum_name(event.type))}};
+  switch (event.type) {
+  case sf::Event::Resized:
+    json["width"] = event.size.width;
+    json["height"] = event.size.height;
+    break;
+  case sf::Event::KeyPressed:
+  case sf::Event::KeyReleased:
+    json["code"] = static_cast<int>(event.key.code);
+    json["alt"] = event.key.alt;
+    json["control"] = event.key.control;
+    json["shift"] = event.key.shift;
+    json["system"] = event.key.system;
+    break;
+  case sf::Event::MouseButtonPressed:
+  case sf::Event::MouseButtonReleased:
+    json["button"] = static_cast<int>(event.mouseButton.button);
+    json["x"] = event.mouseButton.x;
+    json["y"] = event.mouseButton.y;
+    break;
+  case sf::Event::MouseMoved:
+    json["x"] = event.mouseMove.x;
+    json["y"] = event.mouseMove.y;
+    break;
+  default:
+    break;
+  }
+  return json;
+}
+
+sf::Event toEvent(const nlohmann::json &json) {
+  auto type = magic_enum::enum_cast<sf::Event::EventType>(
+      json.at("type").get<std::string>());
+  if (!type.has_value()) {
+    throw std::runtime_error(fmt::format(
+        "{}: unknown event type", json.at("type").get<std::string>()));
+  }
+  sf::Event event{};
+  event.type = *type;
+  switch (event.type) {
+  case sf::Event::Resized:
+    event.size.width = json.at("width").get<unsigned>();
+    event.size.height = json.at("height").get<unsigned>();
+    break;
+  case sf::Event::KeyPressed:
+  case sf::Event::KeyReleased:
+    event.key.code =
+        static_cast<sf::Keyboard::Key>(json.at("code").get<int>());
+    event.key.alt = json.value("alt", false);
+    event.key.control = json.value("control", false);
+    event.key.shift = json.value("shift", false);
+    event.key.system = json.value("system", false);
+    break;
+  case sf::Event::MouseButtonPressed:
+  case sf::Event::MouseButtonReleased:
+    event.mouseButton.button =
+        static_cast<sf::Mouse::Button>(json.at("button").get<int>());
+    event.mouseButton.x = json.at("x").get<int>();
+    event.mouseButton.y = json.at("y").get<int>();
+    break;
+  case sf::Event::MouseMoved:
+    event.mouseMove.x = json.at("x").get<int>();
+    event.mouseMove.y = json.at("y").get<int>();
+    break;
+  default:
+    break;
+  }
+  return event;
+}
+
+} // namespace
+
+void InputRecording::add(InputStamp stamp, const sf::Event &event) {
+  entries_.push_back({std::move(stamp), event});
+}
+
+void InputRecording::save(const std::filesystem::path &path) const {
+  auto events = nlohmann::json::array();
+  for (auto &entry : entries_) {
+    events.push_back(toJson(entry.stamp, entry.event));
+  }
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("{}: can't write input recording", path.string()));
+  }
+  file << nlohmann::json{{"version", INPUT_RECORDING_VERSION},
+                         {"events", std::move(events)}}
+              .dump(2);
+}
+
+InputRecording InputRecording::load(const std::filesystem::path &path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("{}: no such input recording", path.string()));
+  }
+  InputRecording recording;
+  try {
+    auto json = nlohmann::json::parse(file);
+    if (json.at("version").get<int>() != INPUT_RECORDING_VERSION) {
+      throw std::runtime_error("unsupported version");
+    }
+    for (auto &event : json.at("events")) {
+      recording.add({event.at("script").get<std::string>(),
+                     event.at("position").get<std::size_t>(),
+                     sf::microseconds(event.at("delay").get<sf::Int64>())},
+                    toEvent(event));
+    }
+  } catch (const std::exception &err) {
+    throw std::runtime_error(fmt::format("{}: {}", path.string(), err.what()));
+  }
+  return recording;
+}
+
+const sf::Event *InputRecording::due(const std::string &script,
+                                     std::size_t position,
+                                     sf::Time delay) const {
+  auto stamp = next();
+  if (stamp == nullptr || stamp->script != script ||
+      stamp->position != position || stamp->delay > delay) {
+    return nullptr;
+  }
+  return &entries_[next_].event;
+}
+
+const InputStamp *InputRecording::next() const {
+  return next_ < entries_.size() ? &entries_[next_].stamp : nullptr;
+}
+
+void InputRecording::pop() { ++next_; }
+
+std::size_t InputRecording::size() const { return entries_.size(); }
+
+} // namespace sakura
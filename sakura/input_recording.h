@@ -0,0 +1,64 @@
+#ifndef SAKURA_INPUT_RECORDING_H
+#define SAKURA_INPUT_RECORDING_H
+
+#include <SFML/Window.hpp>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace sakura {
+
+// Where the script was when an event was consumed.
+struct InputStamp {
+  std::string script;
+  std::size_t position = 0;
+  // since the script reached `position`
+  sf::Time delay;
+};
+
+// The input events `Engine::handle` consumed, in design units, each stamped
+// with where the script was. Replaying an event once the script gets there
+// again reproduces the playthrough whatever the frame rate.
+//
+// Recording file:
+// {
+//   "version": 1,
+//   "events": [
+//     {
+//       "script": string,
+//       "position": number,
+//       "delay": number, in microseconds
+//       "type": string, an sf::Event::EventType
+//       ...the fields of the event
+//     }
+//   ]
+// }
+class InputRecording {
+public:
+  void add(InputStamp stamp, const sf::Event &event);
+  void save(const std::filesystem::path &path) const;
+  static InputRecording load(const std::filesystem::path &path);
+
+  // Replay: the next event, if the script has reached its stamp.
+  const sf::Event *due(const std::string &script, std::size_t position,
+                       sf::Time delay) const;
+  // The stamp of the next event, or nullptr if all have been replayed.
+  const InputStamp *next() const;
+  void pop();
+  std::size_t size() const;
+
+private:
+  struct Entry {
+    InputStamp stamp;
+    sf::Event event;
+  };
+
+private:
+  std::vector<Entry> entries_;
+  std::size_t next_ = 0;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_INPUT_RECORDING_H
@@ -0,0 +1,221 @@
+#include "job_system.h"
+#include <algorithm>
+#include <climits>
+
+namespace sakura {
+
+namespace {
+
+// the index of the worker running on this thread, if any
+thread_local unsigned current_worker = UINT_MAX;
+
+} // namespace
+
+JobSystem::JobSystem(unsigned workers)
+    : main_thread_(std::this_thread::get_id()) {
+  if (workers == 0) {
+    workers = std::max(2u, std::thread::hardware_concurrency()) - 1;
+  }
+  for (unsigned i = 0; i < workers; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (unsigned i = 0; i < workers; ++i) {
+    threads_.emplace_back(&JobSystem::workerLoop, this, i);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void JobSystem::submit(const TaskPtr &task, const char *name, Lane lane,
+                       std::vector<TaskPtr> dependencies) {
+  task->name_ = name;
+  task->lane_ = lane;
+  task->submitted_ = std::chrono::steady_clock::now();
+  // completing a dependency may run the task before this returns
+  {
+    std::lock_guard lock(task->mutex_);
+    task->dependencies_ = dependencies;
+  }
+  for (auto &dependency : dependencies) {
+    std::lock_guard lock(dependency->mutex_);
+    if (!dependency->done()) {
+      task->pending_.fetch_add(1, std::memory_order_relaxed);
+      dependency->dependents_.push_back(task);
+    }
+  }
+  if (task->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    schedule(task);
+  }
+}
+
+void JobSystem::schedule(TaskPtr task) {
+  if (task->lane_ == MAIN) {
+    std::lock_guard lock(main_mutex_);
+    main_queue_.push_back(std::move(task));
+  } else {
+    // workers push to their own deque, the others spread their tasks
+    auto index = current_worker < workers_.size()
+                     ? current_worker
+                     : next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                           workers_.size();
+    auto &worker = *workers_[index];
+    auto lane = task->lane_;
+    {
+      std::lock_guard lock(worker.mutex);
+      worker.lanes[lane].push_back(std::move(task));
+    }
+    queued_.fetch_add(1, std::memory_order_release);
+    // an empty critical section, so that a worker checking `queued_` under
+    // the lock either sees it or is already waiting
+    { std::lock_guard lock(sleep_mutex_); }
+    work_cv_.notify_one();
+  }
+}
+
+TaskPtr JobSystem::take(unsigned index) {
+  for (unsigned lane = 0; lane < MAIN; ++lane) {
+    {
+      auto &own = *workers_[index];
+      std::lock_guard lock(own.mutex);
+      if (!own.lanes[lane].empty()) {
+        auto task = std::move(own.lanes[lane].back());
+        own.lanes[lane].pop_back();
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+      }
+    }
+    for (std::size_t i = 1; i < workers_.size(); ++i) {
+      auto &victim = *workers_[(index + i) % workers_.size()];
+      std::lock_guard lock(victim.mutex);
+      if (!victim.lanes[lane].empty()) {
+        auto task = std::move(victim.lanes[lane].front());
+        victim.lanes[lane].pop_front();
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+      }
+    }
+  }
+  return nullptr;
+}
+
+bool JobSystem::execute(const TaskPtr &task) {
+  if (task->claimed_.exchange(true, std::memory_order_acq_rel)) {
+    return false;
+  }
+  auto start = std::chrono::steady_clock::now();
+  task->run();
+  auto end = std::chrono::steady_clock::now();
+  {
+    std::chrono::duration<double> wait = start - task->submitted_;
+    std::chrono::duration<double> run = end - start;
+    std::lock_guard lock(stats_mutex_);
+    auto &stats = stats_[task->name_];
+    ++stats.count;
+    stats.wait += wait.count();
+    stats.run += run.count();
+    stats.max_run = std::max(stats.max_run, run.count());
+  }
+  complete(task);
+  return true;
+}
+
+void JobSystem::complete(const TaskPtr &task) {
+  std::vector<TaskPtr> dependents;
+  {
+    std::lock_guard lock(task->mutex_);
+    task->done_.store(true, std::memory_order_release);
+    dependents.swap(task->dependents_);
+    task->dependencies_.clear();
+  }
+  for (auto &dependent : dependents) {
+    if (dependent->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      schedule(std::move(dependent));
+    }
+  }
+  { std::lock_guard lock(sleep_mutex_); }
+  done_cv_.notify_all();
+}
+
+void JobSystem::workerLoop(unsigned index) {
+  current_worker = index;
+  while (true) {
+    if (auto task = take(index)) {
+      execute(task);
+      continue;
+    }
+    std::unique_lock lock(sleep_mutex_);
+    work_cv_.wait(lock, [this] {
+      return stopping_ || queued_.load(std::memory_order_acquire) > 0;
+    });
+    if (stopping_ && queued_.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
+
+bool JobSystem::pump(sf::Time budget) {
+  sf::Clock clock;
+  while (true) {
+    TaskPtr task;
+    {
+      std::lock_guard lock(main_mutex_);
+      if (main_queue_.empty()) {
+        return false;
+      }
+      if (clock.getElapsedTime() >= budget) {
+        return true;
+      }
+      task = std::move(main_queue_.front());
+      main_queue_.pop_front();
+    }
+    execute(task);
+  }
+}
+
+bool JobSystem::hasMainTasks() const {
+  std::lock_guard lock(main_mutex_);
+  return !main_queue_.empty();
+}
+
+void JobSystem::wait(const TaskPtr &task) {
+  if (task->done()) {
+    return;
+  }
+  std::vector<TaskPtr> dependencies;
+  {
+    std::lock_guard lock(task->mutex_);
+    dependencies = task->dependencies_;
+  }
+  for (auto &dependency : dependencies) {
+    wait(dependency);
+  }
+  // it is queued by now, or completing its last dependency is about to
+  // queue it; the queued entry is skipped once claimed here
+  bool runnable = task->lane_ != MAIN ||
+                  std::this_thread::get_id() == main_thread_;
+  if (runnable && task->pending_.load(std::memory_order_acquire) == 0) {
+    execute(task);
+  }
+  std::unique_lock lock(sleep_mutex_);
+  done_cv_.wait(lock, [&] { return task->done(); });
+}
+
+unsigned JobSystem::workerCount() const {
+  return static_cast<unsigned>(workers_.size());
+}
+
+std::map<std::string, JobSystem::TaskStats> JobSystem::stats() const {
+  std::lock_guard lock(stats_mutex_);
+  return stats_;
+}
+
+} // namespace sakura
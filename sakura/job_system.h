@@ -0,0 +1,204 @@
+#ifndef SAKURA_JOB_SYSTEM_H
+#define SAKURA_JOB_SYSTEM_H
+
+#include <SFML/System.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sakura {
+
+class JobSystem;
+
+// A unit of work with the tasks it depends on. It is queued once all of them
+// have completed, and runs exactly once.
+class Task {
+public:
+  virtual ~Task() = default;
+  bool done() const { return done_.load(std::memory_order_acquire); }
+
+protected:
+  virtual void run() = 0;
+
+private:
+  friend class JobSystem;
+
+  const char *name_ = "";
+  unsigned lane_ = 0;
+  // the dependencies not completed yet, plus one while submitting
+  std::atomic<unsigned> pending_{1};
+  // set by whoever runs the task, so that a task queued twice runs once
+  std::atomic<bool> claimed_{false};
+  std::atomic<bool> done_{false};
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Task>> dependencies_;
+  std::vector<std::shared_ptr<Task>> dependents_;
+  std::chrono::steady_clock::time_point submitted_;
+};
+
+using TaskPtr = std::shared_ptr<Task>;
+
+template <typename T> class JobState : public Task {
+public:
+  using Value = std::conditional_t<std::is_void_v<T>, bool, T>;
+
+  explicit JobState(std::function<T()> func) : func_(std::move(func)) {}
+
+protected:
+  void run() override {
+    try {
+      if constexpr (std::is_void_v<T>) {
+        func_();
+        value_.emplace(true);
+      } else {
+        value_.emplace(func_());
+      }
+    } catch (...) {
+      error_ = std::current_exception();
+    }
+    func_ = nullptr;
+  }
+
+private:
+  template <typename U> friend class Job;
+
+  std::function<T()> func_;
+  std::optional<Value> value_;
+  std::exception_ptr error_;
+};
+
+// The result of a submitted task. Unlike a std::future from std::async,
+// dropping it never waits.
+template <typename T> class Job {
+public:
+  Job() = default;
+  Job(JobSystem *jobs, std::shared_ptr<JobState<T>> state)
+      : jobs_(jobs), state_(std::move(state)) {}
+
+  bool valid() const { return state_ != nullptr; }
+  bool ready() const { return state_->done(); }
+  TaskPtr task() const { return state_; }
+
+  // Waits for the task, running it on this thread if it has not started.
+  // Rethrows what the task threw on every call, the value can be taken
+  // once.
+  T get();
+
+private:
+  JobSystem *jobs_ = nullptr;
+  std::shared_ptr<JobState<T>> state_;
+};
+
+// Runs tasks on a worker per core. Each worker has a deque per lane: it takes
+// its own tasks newest first and steals the oldest ones of the others when
+// it runs out. URGENT tasks are taken before any BACKGROUND one. MAIN tasks
+// only run on the thread which created the system, in `pump`, which is
+// where textures are created and uploaded.
+class JobSystem {
+public:
+  enum Lane : unsigned {
+    // needed by the current or the next frame
+    URGENT,
+    // prefetching
+    BACKGROUND,
+    MAIN,
+    LANE_COUNT
+  };
+
+  // Per task name, in seconds.
+  struct TaskStats {
+    std::size_t count = 0;
+    // from being submitted until running, dependencies included
+    double wait = 0;
+    double run = 0;
+    double max_run = 0;
+  };
+
+  // 0 workers means one per core but the calling one.
+  explicit JobSystem(unsigned workers = 0);
+  ~JobSystem();
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  // `name` must be a string literal, tasks are timed under it. `func` runs
+  // once every task of `dependencies` has completed, whether or not it
+  // threw.
+  template <typename F>
+  auto submit(const char *name, Lane lane, F &&func,
+              std::vector<TaskPtr> dependencies = {})
+      -> Job<std::invoke_result_t<F>> {
+    using T = std::invoke_result_t<F>;
+    auto state = std::make_shared<JobState<T>>(std::forward<F>(func));
+    submit(state, name, lane, std::move(dependencies));
+    return {this, std::move(state)};
+  }
+
+  // Runs the MAIN tasks which are ready for about `budget`. Returns whether
+  // some are still queued.
+  bool pump(sf::Time budget);
+  bool hasMainTasks() const;
+  // Waits for `task`, running it here if it has not started and may run on
+  // this thread.
+  void wait(const TaskPtr &task);
+
+  unsigned workerCount() const;
+  std::map<std::string, TaskStats> stats() const;
+
+private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<TaskPtr> lanes[MAIN];
+  };
+
+  void submit(const TaskPtr &task, const char *name, Lane lane,
+              std::vector<TaskPtr> dependencies);
+  void schedule(TaskPtr task);
+  TaskPtr take(unsigned worker);
+  bool execute(const TaskPtr &task);
+  void complete(const TaskPtr &task);
+  void workerLoop(unsigned index);
+
+private:
+  std::thread::id main_thread_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<unsigned> next_worker_{0};
+  // entries in the worker deques, some may have been claimed meanwhile
+  std::atomic<std::size_t> queued_{0};
+  mutable std::mutex main_mutex_;
+  std::deque<TaskPtr> main_queue_;
+  // guards the sleep of workers and waiters
+  std::mutex sleep_mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool stopping_ = false;
+  mutable std::mutex stats_mutex_;
+  std::map<std::string, TaskStats> stats_;
+};
+
+template <typename T> T Job<T>::get() {
+  jobs_->wait(state_);
+  if (state_->error_ != nullptr) {
+    std::rethrow_exception(state_->error_);
+  }
+  if constexpr (!std::is_void_v<T>) {
+    return std::move(*state_->value_);
+  }
+}
+
+} // namespace sakura
+
+#endif // !SAKURA_JOB_SYSTEM_H
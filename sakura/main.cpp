@@ -1,20 +1,152 @@
 #include "engine.h"
+#include "project_check.h"
+#include "utility.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
 #include <fmt/core.h>
 #include <iostream>
+#include <nlohmann/json.hpp>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr const char *USAGE =
+    "usage: sakura [--record <file>] [--replay <file> [--uncapped]]\n"
+    "              [--headless [--frames <count>] [--step <ms>]\n"
+    "               [--dump <frame>,...] [--dump-dir <dir>]] [<project dir>]\n"
+    "       sakura check [-j <jobs>] <project dir>\n";
+
+// Timings of a headless run or a replay, in milliseconds.
+nlohmann::json report(const sakura::FrameStats &stats, double wall_seconds) {
+  nlohmann::json phases;
+  for (std::size_t i = 0; i < sakura::FrameStats::PHASE_COUNT; ++i) {
+    phases[sakura::FrameStats::PHASE_NAMES[i]] = stats.phases[i] * 1e3;
+  }
+  auto frames = nlohmann::json::array();
+  for (auto &timing : stats.timings) {
+    frames.push_back({{"update_ms", timing.update * 1e3},
+                      {"render_ms", timing.render * 1e3},
+                      {"drawn", timing.drawn}});
+  }
+  return {{"wall_ms", wall_seconds * 1e3},
+          {"iterations", stats.iterations},
+          {"drawn", stats.frames},
+          {"latency_ms", stats.latency_mean * 1e3},
+          {"latency_max_ms", stats.latency_max * 1e3},
+          {"phases_ms", std::move(phases)},
+          {"peak_rss_bytes", sakura::peakResidentBytes()},
+          {"frames", std::move(frames)}};
+}
+
+// Prints the issues found in the project as JSON, exits with 1 if there are
+// any.
+int check(int argc, char *argv[]) {
+  std::string dir;
+  unsigned jobs = 0;
+  for (int i = 0; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "-j" && i + 1 < argc) {
+      jobs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      std::cerr << USAGE;
+      return -1;
+    } else {
+      dir = arg;
+    }
+  }
+  if (dir.empty() || !std::filesystem::is_directory(dir)) {
+    std::cerr << USAGE;
+    return -1;
+  }
+  try {
+    sakura::JobSystem job_system(jobs);
+    auto report = sakura::checkProject(dir, job_system);
+    std::cout << report.toJson().dump(2) << '\n';
+    return report.issues.empty() ? 0 : 1;
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << '\n';
+    return -1;
+  }
+}
+
+} // namespace
 
 int main(int argc, char *argv[]) {
+  if (argc > 1 && std::string_view(argv[1]) == "check") {
+    return check(argc - 2, argv + 2);
+  }
   std::string dir = "sakura";
-  if (argc == 2) {
-    dir = argv[1];
+  bool headless = false;
+  std::size_t frame_count = 600;
+  float step = 1000.0f / 60;
+  std::vector<std::size_t> dumps;
+  std::filesystem::path dump_dir = "frames";
+  std::filesystem::path record_path;
+  std::filesystem::path replay_path;
+  bool uncapped = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--headless") {
+      headless = true;
+    } else if (arg == "--frames" && has_value) {
+      frame_count = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--step" && has_value) {
+      step = std::strtof(argv[++i], nullptr);
+    } else if (arg == "--dump" && has_value) {
+      std::istringstream list(argv[++i]);
+      std::string frame;
+      while (std::getline(list, frame, ',')) {
+        dumps.push_back(std::strtoull(frame.c_str(), nullptr, 10));
+      }
+    } else if (arg == "--dump-dir" && has_value) {
+      dump_dir = argv[++i];
+    } else if (arg == "--record" && has_value) {
+      record_path = argv[++i];
+    } else if (arg == "--replay" && has_value) {
+      replay_path = argv[++i];
+    } else if (arg == "--uncapped") {
+      uncapped = true;
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      std::cerr << USAGE;
+      return -1;
+    } else {
+      dir = arg;
+    }
   }
   if (!std::filesystem::is_directory(dir)) {
     std::cerr << fmt::format("{}: no such directory", dir);
     return -1;
   }
 
+  // the engine runs in the project directory
+  dump_dir = std::filesystem::absolute(dump_dir);
+  if (!record_path.empty()) {
+    record_path = std::filesystem::absolute(record_path);
+  }
+  if (!replay_path.empty()) {
+    replay_path = std::filesystem::absolute(replay_path);
+  }
+  auto start = std::chrono::steady_clock::now();
   sakura::Engine engine(dir);
+  engine.headless = headless;
+  engine.frame_count = frame_count;
+  engine.frame_step = sf::microseconds(static_cast<sf::Int64>(step * 1000));
+  engine.dump_frames = std::move(dumps);
+  engine.dump_dir = dump_dir;
+  engine.record_path = record_path;
+  engine.replay_path = replay_path;
+  engine.uncapped = uncapped;
   engine.run();
 
+  if (headless || !replay_path.empty()) {
+    std::chrono::duration<double> wall =
+        std::chrono::steady_clock::now() - start;
+    std::cout << report(engine.frameStats(), wall.count()).dump() << '\n';
+  }
   return 0;
 }
@@ -0,0 +1,357 @@
+#include "project_check.h"
+#include "asset_manifest.h"
+#include "elaina/lexer.h"
+#include "elaina/parser.h"
+#include "scene_proto.h"
+#include "utility.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fmt/core.h>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace sakura {
+
+namespace {
+
+struct FileResult {
+  std::vector<CheckIssue> issues;
+  // variables assigned by `:=`
+  std::vector<std::string> assigned;
+  // variables read, by name in `message`
+  std::vector<CheckIssue> reads;
+};
+
+const char *prefixName(AssetArgument::Kind kind) {
+  switch (kind) {
+  case AssetArgument::BACKGROUND:
+  case AssetArgument::SPRITE:
+    return "texture";
+  case AssetArgument::MUSIC:
+    return "music";
+  case AssetArgument::SOUND:
+    return "sound";
+  case AssetArgument::SCENE:
+    return "scene";
+  case AssetArgument::SCRIPT:
+    return "script";
+  }
+  return "";
+}
+
+const CommandSignature *findSignature(const std::string &command) {
+  auto it = std::find_if(std::begin(COMMAND_SIGNATURES),
+                         std::end(COMMAND_SIGNATURES),
+                         [&](const CommandSignature &signature) {
+                           return command == signature.command;
+                         });
+  return it == std::end(COMMAND_SIGNATURES) ? nullptr : it;
+}
+
+void collectReads(const elaina::Ast &ast, const std::string &file_name,
+                  std::vector<CheckIssue> &reads) {
+  switch (ast.type()) {
+  case elaina::Ast::IDENTIFIER: {
+    auto &token = dynamic_cast<const elaina::IdentifierAst &>(ast).identifier;
+    reads.push_back({file_name, token.row_num, token.col_num, token.value});
+    break;
+  }
+  case elaina::Ast::EXPRESSION: {
+    auto &expression = dynamic_cast<const elaina::ExpressionAst &>(ast);
+    collectReads(*expression.lhs, file_name, reads);
+    collectReads(*expression.rhs, file_name, reads);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+class Checker {
+public:
+  Checker(const std::filesystem::path &dir, const nlohmann::json &config)
+      : dir_(dir) {
+    auto prefixes = config.find("prefixes");
+    if (prefixes == config.end()) {
+      return;
+    }
+    if (!prefixes->is_object()) {
+      issues_.push_back({"sakura.json", 0, 0, "prefixes: expects an object"});
+      return;
+    }
+    for (auto &prefix : prefixes->items()) {
+      if (prefix.value().is_string()) {
+        prefixes_[prefix.key()] = prefix.value().get<std::string>();
+      } else {
+        issues_.push_back(
+            {"sakura.json", 0, 0,
+             fmt::format("prefixes: {}: expects a string", prefix.key())});
+      }
+    }
+  }
+
+  // Issues found in the project configuration itself.
+  const std::vector<CheckIssue> &issues() const { return issues_; }
+
+  // Where the engine looks for files of the `name` prefix.
+  std::filesystem::path prefix(const std::string &name) const {
+    auto it = prefixes_.find(name);
+    return it == prefixes_.end() ? dir_ : dir_ / it->second;
+  }
+
+  std::size_t references() const {
+    std::lock_guard lock(mutex_);
+    return exists_.size();
+  }
+
+  FileResult checkScript(const std::string &file_name) const {
+    FileResult result;
+    std::vector<std::unique_ptr<elaina::Ast>> script;
+    try {
+      std::ifstream file(concat_if_relative(prefix("script"), file_name));
+      if (!file.is_open()) {
+        throw std::runtime_error(fmt::format("{}: can't open file", file_name));
+      }
+      elaina::Lexer lexer(file_name, file);
+      elaina::Parser parser(lexer);
+      script = parser.parse();
+    } catch (const std::exception &err) {
+      result.issues.push_back({file_name, 0, 0, err.what()});
+      return result;
+    }
+
+    for (auto &ast : script) {
+      if (ast->type() != elaina::Ast::COMMAND) {
+        continue;
+      }
+      auto &command = dynamic_cast<const elaina::CommandAst &>(*ast);
+      auto &token = command.command;
+      auto issue = [&](const std::string &message) {
+        result.issues.push_back({file_name, token.row_num, token.col_num,
+                                 fmt::format("{}: {}", token.value, message)});
+      };
+      for (auto &arg : command.args) {
+        collectReads(*arg, file_name, result.reads);
+      }
+
+      auto signature = findSignature(token.value);
+      if (signature == nullptr) {
+        issue("no such command");
+        continue;
+      }
+      auto param_count = std::strlen(signature->params);
+      if (command.args.size() < signature->required) {
+        issue(fmt::format("too few arguments, expects {}", signature->required));
+      } else if (command.args.size() > param_count) {
+        issue(fmt::format("too many arguments, expects {}", param_count));
+      }
+      for (std::size_t i = 0; i < std::min(command.args.size(), param_count);
+           ++i) {
+        bool is_string = command.args[i]->type() == elaina::Ast::STRING;
+        if (is_string != (signature->params[i] == 's')) {
+          issue(fmt::format("argument {} expects {}", i + 1,
+                            is_string ? "an integer" : "a string"));
+        }
+      }
+
+      if (token.value == ":=" && !command.args.empty() &&
+          command.args[0]->type() == elaina::Ast::STRING) {
+        result.assigned.push_back(
+            dynamic_cast<const elaina::StringAst &>(*command.args[0]).value);
+      }
+      for (auto &argument : ASSET_ARGUMENTS) {
+        if (token.value != argument.command ||
+            argument.index >= command.args.size() ||
+            command.args[argument.index]->type() != elaina::Ast::STRING) {
+          continue;
+        }
+        auto &value =
+            dynamic_cast<const elaina::StringAst &>(*command.args[argument.index])
+                .value;
+        if (!exists(prefixName(argument.kind), value)) {
+          issue(fmt::format("{}: no such {} file", value,
+                            prefixName(argument.kind)));
+        }
+      }
+    }
+    return result;
+  }
+
+  FileResult checkScene(const std::string &file_name) const {
+    FileResult result;
+    auto issue = [&](const std::string &message) {
+      result.issues.push_back({file_name, 0, 0, message});
+    };
+    SceneProto proto;
+    try {
+      std::ifstream file(concat_if_relative(prefix("scene"), file_name));
+      if (!file.is_open()) {
+        throw std::runtime_error(
+            fmt::format("{}: can't open scene config file", file_name));
+      }
+      nlohmann::json config;
+      file >> config;
+      proto = SceneProto::compile(config, file_name);
+    } catch (const std::exception &err) {
+      issue(err.what());
+      return result;
+    }
+
+    if (!proto.font_face.empty() && !exists("font", proto.font_face)) {
+      issue(fmt::format("{}: no such font file", proto.font_face));
+    }
+    for (auto &texture : proto.textures) {
+      if (!exists("texture", texture)) {
+        issue(fmt::format("{}: no such texture file", texture));
+      }
+    }
+    for (auto &widget : proto.widgets) {
+      for (auto &action : widget.actions) {
+        if (!action.empty() && !exists("script", action)) {
+          issue(fmt::format("{}: no such script file", action));
+        }
+      }
+    }
+    return result;
+  }
+
+private:
+  // Files are stat-ed once, however many times they are referenced.
+  bool exists(const char *prefix_name, const std::string &file_name) const {
+    std::filesystem::path path =
+        concat_if_relative(prefix(prefix_name), file_name);
+    auto key = path.string();
+    {
+      std::lock_guard lock(mutex_);
+      auto it = exists_.find(key);
+      if (it != exists_.end()) {
+        return it->second;
+      }
+    }
+    std::error_code ec;
+    bool found = std::filesystem::is_regular_file(path, ec);
+    std::lock_guard lock(mutex_);
+    exists_.emplace(std::move(key), found);
+    return found;
+  }
+
+private:
+  std::filesystem::path dir_;
+  std::unordered_map<std::string, std::filesystem::path> prefixes_;
+  std::vector<CheckIssue> issues_;
+  mutable std::mutex mutex_;
+  mutable std::unordered_map<std::string, bool> exists_;
+};
+
+// The files under `root` matching `filter`, relative to it.
+template <typename Filter>
+std::vector<std::string> listFiles(const std::filesystem::path &root,
+                                   Filter filter) {
+  std::vector<std::string> names;
+  std::error_code ec;
+  for (std::filesystem::recursive_directory_iterator it(root, ec), end;
+       !ec && it != end; it.increment(ec)) {
+    if (it->is_regular_file() && filter(it->path())) {
+      names.push_back(
+          std::filesystem::relative(it->path(), root).generic_string());
+    }
+  }
+  return names;
+}
+
+} // namespace
+
+nlohmann::json CheckReport::toJson() const {
+  auto list = nlohmann::json::array();
+  for (auto &issue : issues) {
+    list.push_back({{"file", issue.file},
+                    {"line", issue.line},
+                    {"column", issue.column},
+                    {"message", issue.message}});
+  }
+  return {{"scripts", scripts},
+          {"scenes", scenes},
+          {"references", references},
+          {"seconds", seconds},
+          {"issues", std::move(list)}};
+}
+
+CheckReport checkProject(const std::filesystem::path &dir, JobSystem &jobs) {
+  auto start = std::chrono::steady_clock::now();
+  CheckReport report;
+
+  nlohmann::json config;
+  {
+    std::ifstream file(dir / "sakura.json");
+    if (!file.is_open()) {
+      throw std::runtime_error(
+          "sakura.json: no such file, expects project configuration");
+    }
+    file >> config;
+  }
+  Checker checker(dir, config);
+  report.issues = checker.issues();
+
+  auto scripts =
+      listFiles(checker.prefix("script"), [](const std::filesystem::path &path) {
+        return path.extension() == ".ela";
+      });
+  auto scenes =
+      listFiles(checker.prefix("scene"), [](const std::filesystem::path &path) {
+        return path.extension() == ".json" && path.filename() != "sakura.json" &&
+               path.filename() != "manifest.json";
+      });
+  report.scripts = scripts.size();
+  report.scenes = scenes.size();
+
+  std::vector<Job<FileResult>> results;
+  results.reserve(scripts.size() + scenes.size());
+  for (auto &name : scripts) {
+    results.push_back(jobs.submit("check script", JobSystem::URGENT,
+                                  [&checker, &name] {
+                                    return checker.checkScript(name);
+                                  }));
+  }
+  for (auto &name : scenes) {
+    results.push_back(jobs.submit("check scene", JobSystem::URGENT,
+                                  [&checker, &name] {
+                                    return checker.checkScene(name);
+                                  }));
+  }
+
+  // a variable may be assigned in any script before it is read
+  std::unordered_set<std::string> assigned;
+  std::vector<CheckIssue> reads;
+  for (auto &job : results) {
+    auto result = job.get();
+    std::move(result.issues.begin(), result.issues.end(),
+              std::back_inserter(report.issues));
+    assigned.insert(result.assigned.begin(), result.assigned.end());
+    std::move(result.reads.begin(), result.reads.end(),
+              std::back_inserter(reads));
+  }
+  for (auto &read : reads) {
+    if (assigned.count(read.message) == 0) {
+      read.message = fmt::format("{}: no such variable", read.message);
+      report.issues.push_back(std::move(read));
+    }
+  }
+
+  std::sort(report.issues.begin(), report.issues.end(),
+            [](const CheckIssue &lhs, const CheckIssue &rhs) {
+              return std::tie(lhs.file, lhs.line, lhs.column, lhs.message) <
+                     std::tie(rhs.file, rhs.line, rhs.column, rhs.message);
+            });
+  report.references = checker.references();
+  report.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  return report;
+}
+
+} // namespace sakura
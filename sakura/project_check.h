@@ -0,0 +1,58 @@
+#ifndef SAKURA_PROJECT_CHECK_H
+#define SAKURA_PROJECT_CHECK_H
+
+#include "job_system.h"
+#include <cstddef>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace sakura {
+
+// The arguments a command pops: 'i' for an integer, 's' for a string. The
+// first `required` ones must be given.
+struct CommandSignature {
+  const char *command;
+  const char *params;
+  std::size_t required;
+};
+
+// Every command registered by `elaina::ScriptEngine` and `Engine`.
+inline constexpr CommandSignature COMMAND_SIGNATURES[] = {
+    {":=", "si", 2},         {"if", "iss", 3},        {"jump", "s", 1},
+    {"wait", "", 0},         {"say", "ss", 2},        {"bgm", "s", 1},
+    {"pauseBgm", "", 0},     {"stopBgm", "", 0},      {"voice", "s", 1},
+    {"se", "s", 1},          {"background", "s", 1},  {"addSprite", "ssiii", 4},
+    {"rmSprite", "s", 1},    {"select", "ssss", 4},   {"scene", "s", 1},
+};
+
+struct CheckIssue {
+  std::string file;
+  // 0 if unknown
+  std::size_t line = 0;
+  std::size_t column = 0;
+  std::string message;
+};
+
+struct CheckReport {
+  std::size_t scripts = 0;
+  std::size_t scenes = 0;
+  // distinct asset and script paths referenced
+  std::size_t references = 0;
+  double seconds = 0;
+  std::vector<CheckIssue> issues;
+
+  nlohmann::json toJson() const;
+};
+
+// Finds without running the project what would otherwise fail only once
+// playback reaches it: scripts and scene config files which don't parse,
+// unknown commands, wrong arguments, variables never assigned and missing
+// assets. Every script and scene under the prefixes of `dir` is checked on
+// the workers of `jobs`.
+CheckReport checkProject(const std::filesystem::path &dir, JobSystem &jobs);
+
+} // namespace sakura
+
+#endif // !SAKURA_PROJECT_CHECK_H
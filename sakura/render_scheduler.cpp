@@ -0,0 +1,22 @@
+#include "render_scheduler.h"
+
+namespace sakura {
+
+void RenderScheduler::invalidate(unsigned layers) { dirty_ |= layers; }
+
+unsigned RenderScheduler::dirty() const { return dirty_; }
+
+void RenderScheduler::presented() { dirty_ = 0; }
+
+void RenderScheduler::setFocused(bool focused) {
+  if (focused && !focused_) {
+    invalidate(WINDOW);
+  }
+  focused_ = focused;
+}
+
+sf::Time RenderScheduler::idleTimeout() const {
+  return focused_ ? focused_timeout : unfocused_timeout;
+}
+
+} // namespace sakura
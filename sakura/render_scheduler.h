@@ -0,0 +1,44 @@
+#ifndef SAKURA_RENDER_SCHEDULER_H
+#define SAKURA_RENDER_SCHEDULER_H
+
+#include <SFML/System.hpp>
+
+namespace sakura {
+
+// Tracks what has changed since the last frame, so that a static screen is
+// not redrawn.
+class RenderScheduler {
+public:
+  enum Layer : unsigned {
+    BACKGROUND = 1 << 0,
+    SPRITES = 1 << 1,
+    SCENE = 1 << 2,
+    TEXT = 1 << 3,
+    // invalidated every frame while something animates
+    ANIMATION = 1 << 4,
+    // the window contents may have been lost
+    WINDOW = 1 << 5,
+    ALL = (1 << 6) - 1
+  };
+
+  void invalidate(unsigned layers = ALL);
+  // The layers invalidated since the last `presented`.
+  unsigned dirty() const;
+  void presented();
+
+  void setFocused(bool focused);
+  // How long to sleep when nothing is dirty and the script is blocked.
+  sf::Time idleTimeout() const;
+
+public:
+  sf::Time focused_timeout = sf::milliseconds(8);
+  sf::Time unfocused_timeout = sf::milliseconds(100);
+
+private:
+  unsigned dirty_ = ALL;
+  bool focused_ = true;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_RENDER_SCHEDULER_H
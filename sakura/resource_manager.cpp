@@ -1,131 +1,608 @@
 #include "resource_manager.h"
+#include "content_hash.h"
+#include "cooked_texture.h"
+#include "image_scaling.h"
 #include "utility.h"
-#include "widget_factory.h"
+#include <algorithm>
+#include <charconv>
 #include <fmt/core.h>
 #include <fstream>
+#include <iostream>
 #include <nlohmann/json.hpp>
 #include <stdexcept>
+#include <vector>
 
 namespace sakura {
 
-std::shared_ptr<sf::Texture>
-ResourceManager::loadTexture(const std::string &file_name) {
-  auto it = textures_.find(file_name);
-  if (it == textures_.end()) {
-    std::shared_ptr<sf::Texture> ptr = std::make_shared<sf::Texture>();
-    if (ptr->loadFromFile(concat_if_relative(prefixes["texture"], file_name)) ==
-        false) {
-      throw std::runtime_error(
-          fmt::format("{}: can't load texture file", file_name));
+namespace {
+
+// sf::Font reads the file lazily, so the bytes must live as long as the font.
+struct FontFile {
+  std::vector<char> bytes;
+  sf::Font font;
+};
+
+template <typename T>
+std::shared_ptr<T>
+findContent(std::unordered_map<std::uint64_t, std::weak_ptr<T>> &contents,
+            std::uint64_t hash) {
+  if (hash == 0) {
+    return nullptr;
+  }
+  auto it = contents.find(hash);
+  if (it == contents.end()) {
+    return nullptr;
+  }
+  auto ptr = it->second.lock();
+  if (ptr == nullptr) {
+    contents.erase(it);
+  }
+  return ptr;
+}
+
+std::size_t textureBytes(const sf::Texture &texture) {
+  return std::size_t{texture.getSize().x} * texture.getSize().y * 4;
+}
+
+// The hash recorded for `file_name` by sakura-cook, or 0 if there is none or
+// the file has been changed since.
+std::uint64_t manifestHash(
+    const std::unordered_map<std::string, ResourceManager::ManifestEntry> &hashes,
+    const std::string &file_name, const std::string &path) {
+  auto it = hashes.find(file_name);
+  if (it == hashes.end()) {
+    return 0;
+  }
+  std::error_code ec;
+  auto size = std::filesystem::file_size(path, ec);
+  if (ec || size != it->second.size) {
+    return 0;
+  }
+  auto time = std::filesystem::last_write_time(path, ec);
+  if (ec || time.time_since_epoch().count() != it->second.time) {
+    return 0;
+  }
+  return it->second.hash;
+}
+
+template <typename Table>
+std::size_t unloadExcept(Table &table, const std::unordered_set<AssetId> &keep) {
+  std::size_t count = 0;
+  table.forEach([&](AssetId id, auto &slot) {
+    if (slot.data != nullptr && keep.count(id) == 0) {
+      slot.data = nullptr;
+      ++count;
+    }
+  });
+  return count;
+}
+
+} // namespace
+
+// Manifest:
+// {
+//   "textures": {
+//     <file name>: { "hash": string, "size": number, "time": number }
+//   },
+//   "fonts": {
+//     <file name>: { "hash": string, "size": number, "time": number }
+//   }
+// }
+
+ResourceManager::ResourceManager(JobSystem &jobs) : jobs_(jobs) {}
+
+void ResourceManager::loadManifest(const std::filesystem::path &path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("{}: can't open manifest file", path.string()));
+  }
+  nlohmann::json manifest;
+  file >> manifest;
+
+  auto read = [&](const char *key,
+                  std::unordered_map<std::string, ManifestEntry> &hashes) {
+    if (!exists<nlohmann::json::value_t::object>(manifest, key)) {
+      return;
+    }
+    for (auto &[name, value] : manifest[key].items()) {
+      if (!exists<nlohmann::json::value_t::string>(value, "hash") ||
+          !value["size"].is_number_unsigned() ||
+          !value["time"].is_number_integer()) {
+        continue;
+      }
+      ManifestEntry entry;
+      const auto &hash = value["hash"].get_ref<const std::string &>();
+      auto [end, ec] =
+          std::from_chars(hash.data(), hash.data() + hash.size(), entry.hash, 16);
+      if (ec != std::errc{} || end != hash.data() + hash.size() ||
+          entry.hash == 0) {
+        std::cerr << fmt::format("{}: {}: invalid hash, ignored\n",
+                                 path.string(), name);
+        continue;
+      }
+      entry.size = value["size"].get<std::uintmax_t>();
+      entry.time = value["time"].get<std::int64_t>();
+      hashes.emplace(name, entry);
     }
-    textures_[file_name] = ptr;
-    return ptr;
+  };
+  read("textures", texture_hashes_);
+  read("fonts", font_hashes_);
+}
+
+AssetId ResourceManager::internTexture(const std::string &file_name) {
+  auto [id, inserted] = textures_.intern(file_name, [&] {
+    return concat_if_relative(prefix("texture"), file_name);
+  });
+  if (inserted) {
+    auto &slot = textures_[id];
+    slot.content_hash = manifestHash(texture_hashes_, file_name, slot.path);
+  }
+  return id;
+}
+
+AssetId ResourceManager::internMusic(const std::string &file_name) {
+  return pieces_of_music_
+      .intern(file_name,
+              [&] { return concat_if_relative(prefix("music"), file_name); })
+      .first;
+}
+
+AssetId ResourceManager::internSound(const std::string &file_name) {
+  return sounds_
+      .intern(file_name,
+              [&] { return concat_if_relative(prefix("sound"), file_name); })
+      .first;
+}
+
+AssetId ResourceManager::internFont(const std::string &file_name) {
+  auto [id, inserted] = fonts_.intern(file_name, [&] {
+    return concat_if_relative(prefix("font"), file_name);
+  });
+  if (inserted) {
+    auto &slot = fonts_[id];
+    slot.content_hash = manifestHash(font_hashes_, file_name, slot.path);
+  }
+  return id;
+}
+
+AssetId ResourceManager::internScene(const std::string &file_name) {
+  return scenes_
+      .intern(file_name,
+              [&] { return concat_if_relative(prefix("scene"), file_name); })
+      .first;
+}
+
+ResourceManager::PreparedTexture
+ResourceManager::prepareTexture(const std::string &path,
+                                sf::Vector2f display_size, float pixel_ratio) {
+  PreparedTexture prepared;
+  CookedTextureHeader header;
+  if (readCookedTexture(path, header, prepared.pixels)) {
+    prepared.info.source_size = {header.width, header.height};
+    prepared.content_hash = header.source_hash;
   } else {
-    return it->second;
+    std::vector<char> bytes;
+    sf::Image image;
+    if (!readFile(path, bytes, prepared.content_hash) ||
+        !image.loadFromMemory(bytes.data(), bytes.size())) {
+      throw std::runtime_error(fmt::format("{}: can't load texture file", path));
+    }
+    auto size = image.getSize();
+    prepared.info.source_size = size;
+    prepared.pixels.assign(image.getPixelsPtr(),
+                           image.getPixelsPtr() +
+                               std::size_t{size.x} * size.y * 4);
+    premultiplyAlpha(prepared.pixels.data(), std::size_t{size.x} * size.y);
   }
+  prepared.info.tier =
+      selectTier(prepared.info.source_size, display_size, pixel_ratio);
+  prepared.size = downscaleImage(prepared.pixels, prepared.info.source_size,
+                                 prepared.info.tier);
+  return prepared;
 }
 
-std::shared_ptr<sf::Music>
-ResourceManager::loadMusic(const std::string &file_name) {
-  auto it = pieces_of_music_.find(file_name);
-  if (it == pieces_of_music_.end()) {
-    std::shared_ptr<sf::Music> ptr = std::make_shared<sf::Music>();
-    if (ptr->openFromFile(concat_if_relative(prefixes["music"], file_name)) ==
-        false) {
-      throw std::runtime_error(
-          fmt::format("{}: can't load music file", file_name));
+std::shared_ptr<sf::Texture>
+ResourceManager::findTexture(std::uint64_t hash, sf::Vector2f display_size,
+                             TextureInfo &info) {
+  if (hash == 0) {
+    return nullptr;
+  }
+  auto it = texture_contents_.find(hash);
+  if (it == texture_contents_.end()) {
+    return nullptr;
+  }
+  auto ptr = it->second.texture.lock();
+  if (ptr == nullptr) {
+    texture_contents_.erase(it);
+    return nullptr;
+  }
+  // identical contents have the same size, so the wanted tier is known
+  // without decoding
+  const auto &cached = it->second.info;
+  if (cached.tier > selectTier(cached.source_size, display_size, pixel_ratio)) {
+    return nullptr;
+  }
+  info = cached;
+  ++stats_.deduplicated;
+  stats_.deduplicated_bytes += textureBytes(*ptr);
+  return ptr;
+}
+
+std::shared_ptr<sf::Texture> ResourceManager::loadTexture(AssetId id,
+                                                          sf::Vector2f
+                                                              display_size) {
+  auto &slot = textures_[id];
+  if (slot.data != nullptr &&
+      slot.info.tier <=
+          selectTier(slot.info.source_size, display_size, pixel_ratio)) {
+    ++stats_.hits;
+    return slot.data;
+  }
+  ++stats_.misses;
+
+  PreparedTexture prepared;
+  auto pending = pending_textures_.find(id);
+  if (pending != pending_textures_.end()) {
+    prepared = pending->second.get();
+    pending_textures_.erase(pending);
+    if (prepared.info.tier > selectTier(prepared.info.source_size,
+                                        display_size, pixel_ratio)) {
+      prepared = prepareTexture(slot.path, display_size, pixel_ratio);
     }
-    pieces_of_music_[file_name] = ptr;
-    return ptr;
   } else {
-    return it->second;
+    // the hash is known without decoding if the texture is in the manifest
+    // or has been cooked
+    CookedTextureHeader header;
+    if (slot.content_hash == 0 && findCookedTexture(slot.path, header)) {
+      slot.content_hash = header.source_hash;
+    }
+    if (auto shared = findTexture(slot.content_hash, display_size, slot.info)) {
+      return slot.data = shared;
+    }
+    prepared = prepareTexture(slot.path, display_size, pixel_ratio);
+  }
+
+  slot.content_hash = prepared.content_hash;
+  if (auto shared = findTexture(slot.content_hash, display_size, slot.info)) {
+    return slot.data = shared;
+  }
+
+  auto ptr = std::make_shared<sf::Texture>();
+  if (!ptr->create(prepared.size.x, prepared.size.y)) {
+    throw std::runtime_error(
+        fmt::format("{}: can't create texture", slot.name));
+  }
+  ptr->update(prepared.pixels.data());
+  if (prepared.info.tier > 0) {
+    // the tier may still be up to twice as large as on screen
+    ptr->setSmooth(true);
+    ptr->generateMipmap();
+  }
+  slot.info = prepared.info;
+  if (slot.content_hash != 0) {
+    texture_contents_[slot.content_hash] = {ptr, slot.info};
   }
+  return slot.data = std::move(ptr);
 }
 
-std::shared_ptr<sf::Font>
-ResourceManager::loadFont(const std::string &file_name) {
-  auto it = fonts_.find(file_name);
-  if (it == fonts_.end()) {
-    std::shared_ptr<sf::Font> ptr = std::make_shared<sf::Font>();
-    if (ptr->loadFromFile(concat_if_relative(prefixes["font"], file_name)) ==
-        false) {
+void ResourceManager::prefetchTexture(AssetId id, sf::Vector2f display_size) {
+  const auto &slot = textures_[id];
+  if (slot.data != nullptr || pending_textures_.count(id) != 0) {
+    return;
+  }
+  auto decode = jobs_.submit("decode texture", JobSystem::BACKGROUND,
+                             [path = slot.path, display_size,
+                              pixel_ratio = pixel_ratio] {
+                               return prepareTexture(path, display_size,
+                                                     pixel_ratio);
+                             });
+  pending_textures_.emplace(id, decode);
+  jobs_.submit(
+      "upload texture", JobSystem::MAIN,
+      [this, id, display_size, task = decode.task()] {
+        // unless it has been loaded, released or dropped meanwhile
+        auto it = pending_textures_.find(id);
+        if (it != pending_textures_.end() && it->second.task() == task) {
+          loadTexture(id, display_size);
+        }
+      },
+      {decode.task()});
+}
+
+sf::Vector2f ResourceManager::designSize(AssetId id) const {
+  auto size = textures_[id].info.source_size;
+  return {static_cast<float>(size.x), static_cast<float>(size.y)};
+}
+
+std::shared_ptr<sf::Music> ResourceManager::loadMusic(AssetId id) {
+  auto &slot = pieces_of_music_[id];
+  if (slot.data == nullptr) {
+    auto ptr = std::make_shared<sf::Music>();
+    if (ptr->openFromFile(slot.path) == false) {
       throw std::runtime_error(
-          fmt::format("{}: can't load font file", file_name));
+          fmt::format("{}: can't load music file", slot.name));
     }
-    fonts_[file_name] = ptr;
-    return ptr;
-  } else {
-    return it->second;
+    slot.data = std::move(ptr);
   }
+  return slot.data;
 }
 
-// Scene:
-// {
-//   "font_face": string,
-//   "font_size": <optional: 24> number,
-//   "main_dialog": <optional> Dialog,
-//   "selector": <optional> {
-//     "first": PushButton,
-//     "second": PushButton
-//   },
-//   "widgets": [
-//     <optional>
-//   ]
-// }
+Job<std::shared_ptr<sf::Music>> ResourceManager::openMusic(AssetId id) {
+  const auto &slot = pieces_of_music_[id];
+  return jobs_.submit("open music", JobSystem::URGENT,
+                      [name = slot.name, path = slot.path] {
+                        auto ptr = std::make_shared<sf::Music>();
+                        if (ptr->openFromFile(path) == false) {
+                          throw std::runtime_error(fmt::format(
+                              "{}: can't load music file", name));
+                        }
+                        return ptr;
+                      });
+}
 
-std::shared_ptr<Scene>
-ResourceManager::loadScene(const std::string &file_name) {
-  auto it = scenes_.find(file_name);
-  if (it != scenes_.end()) {
-    return it->second;
+ResourceManager::PreparedSound
+ResourceManager::prepareSound(const std::string &path) {
+  sf::InputSoundFile file;
+  if (file.openFromFile(path) == false) {
+    throw std::runtime_error(fmt::format("{}: can't load sound file", path));
+  }
+  PreparedSound prepared;
+  prepared.channel_count = file.getChannelCount();
+  prepared.sample_rate = file.getSampleRate();
+  prepared.samples.resize(static_cast<std::size_t>(file.getSampleCount()));
+  prepared.samples.resize(static_cast<std::size_t>(
+      file.read(prepared.samples.data(), prepared.samples.size())));
+  return prepared;
+}
+
+void ResourceManager::prefetchSound(AssetId id) {
+  const auto &slot = sounds_[id];
+  if (slot.data != nullptr || pending_sounds_.count(id) != 0) {
+    return;
   }
+  pending_sounds_.emplace(
+      id, jobs_.submit("decode sound", JobSystem::URGENT,
+                       [path = slot.path] { return prepareSound(path); }));
+}
 
-  std::ifstream file(concat_if_relative(prefixes["scene"], file_name));
-  nlohmann::json config;
-  WidgetFactory factory(*this);
-  if (!file.is_open()) {
+std::shared_ptr<sf::SoundBuffer> ResourceManager::loadSound(AssetId id) {
+  auto &slot = sounds_[id];
+  slot.info.last_used = ++sound_clock_;
+  if (slot.data != nullptr) {
+    ++stats_.hits;
+    return slot.data;
+  }
+  ++stats_.misses;
+
+  PreparedSound prepared;
+  auto pending = pending_sounds_.find(id);
+  if (pending != pending_sounds_.end()) {
+    prepared = pending->second.get();
+    pending_sounds_.erase(pending);
+  } else {
+    prepared = prepareSound(slot.path);
+  }
+  auto ptr = std::make_shared<sf::SoundBuffer>();
+  if (!ptr->loadFromSamples(prepared.samples.data(), prepared.samples.size(),
+                            prepared.channel_count, prepared.sample_rate)) {
     throw std::runtime_error(
-        fmt::format("{}: can't open scene config file", file_name));
+        fmt::format("{}: can't load sound file", slot.name));
+  }
+  slot.info.bytes = prepared.samples.size() * sizeof(sf::Int16);
+  sound_bytes_ += slot.info.bytes;
+  slot.data = std::move(ptr);
+  trimSounds(id);
+  return slot.data;
+}
+
+void ResourceManager::trimSounds(AssetId keep) {
+  while (sound_bytes_ > sound_budget) {
+    AssetId victim = INVALID_ASSET;
+    std::uint64_t oldest = UINT64_MAX;
+    sounds_.forEach([&](AssetId id, auto &slot) {
+      // a buffer referred to by a sound is playing or about to
+      if (id != keep && slot.data != nullptr && slot.data.use_count() == 1 &&
+          slot.info.last_used < oldest) {
+        victim = id;
+        oldest = slot.info.last_used;
+      }
+    });
+    if (victim == INVALID_ASSET) {
+      break;
+    }
+    auto &slot = sounds_[victim];
+    sound_bytes_ -= slot.info.bytes;
+    slot.data = nullptr;
+    ++stats_.unloaded;
   }
-  file >> config;
+}
 
-  std::shared_ptr<Scene> scene = std::make_shared<Scene>();
+std::shared_ptr<sf::Font> ResourceManager::loadFont(AssetId id) {
+  auto &slot = fonts_[id];
+  if (slot.data != nullptr) {
+    ++stats_.hits;
+    return slot.data;
+  }
+  ++stats_.misses;
 
-  if (!exists<nlohmann::json::value_t::string>(config, "font_face")) {
+  if (auto shared = findContent(font_contents_, slot.content_hash)) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(slot.path, ec);
+    ++stats_.deduplicated;
+    stats_.deduplicated_bytes += ec ? 0 : static_cast<std::size_t>(size);
+    return slot.data = shared;
+  }
+
+  auto file = std::make_shared<FontFile>();
+  if (!readFile(slot.path, file->bytes, slot.content_hash)) {
+    throw std::runtime_error(
+        fmt::format("{}: can't load font file", slot.name));
+  }
+  if (auto shared = findContent(font_contents_, slot.content_hash)) {
+    ++stats_.deduplicated;
+    stats_.deduplicated_bytes += file->bytes.size();
+    return slot.data = shared;
+  }
+  if (file->font.loadFromMemory(file->bytes.data(), file->bytes.size()) ==
+      false) {
     throw std::runtime_error(
-        fmt::format("{}: expects font_face configuration", file_name));
+        fmt::format("{}: can't load font file", slot.name));
+  }
+  std::shared_ptr<sf::Font> ptr{file, &file->font};
+  font_contents_[slot.content_hash] = ptr;
+  std::erase_if(font_bytes_, [](const auto &entry) {
+    return entry.second.expired();
+  });
+  font_bytes_[&file->font] =
+      std::shared_ptr<const std::vector<char>>{file, &file->bytes};
+  return slot.data = std::move(ptr);
+}
+
+std::shared_ptr<const std::vector<char>>
+ResourceManager::fontBytes(const sf::Font &font) const {
+  auto it = font_bytes_.find(&font);
+  return it == font_bytes_.end() ? nullptr : it->second.lock();
+}
+
+const std::shared_ptr<ResourceManager::CompiledScene> &
+ResourceManager::compiledScene(AssetId id) {
+  auto &slot = scenes_[id];
+  if (slot.data == nullptr) {
+    slot.data = std::make_shared<CompiledScene>(
+        compileScene(slot.name, slot.path));
+  }
+  return slot.data;
+}
+
+const SceneProto &ResourceManager::sceneProto(AssetId id) {
+  return compiledScene(id)->proto;
+}
+
+void ResourceManager::prefetchScene(AssetId id) {
+  auto &compiled = compiledScene(id);
+  for (std::size_t i = 0; i < compiled->textures.size(); ++i) {
+    prefetchTexture(compiled->textures[i], compiled->texture_sizes[i]);
+  }
+}
+
+std::shared_ptr<Scene> ResourceManager::loadScene(AssetId id) {
+  prefetchScene(id);
+  // keep the compiled scene alive even if it is released meanwhile
+  auto compiled = compiledScene(id);
+  std::vector<std::shared_ptr<sf::Texture>> textures;
+  textures.reserve(compiled->textures.size());
+  for (std::size_t i = 0; i < compiled->textures.size(); ++i) {
+    textures.push_back(
+        loadTexture(compiled->textures[i], compiled->texture_sizes[i]));
   }
+  return Scene::instantiate(compiled->proto, std::move(textures),
+                            loadFont(compiled->font));
+}
+
+std::shared_ptr<sf::Texture>
+ResourceManager::loadTexture(const std::string &file_name,
+                             sf::Vector2f display_size) {
+  return loadTexture(internTexture(file_name), display_size);
+}
+
+std::shared_ptr<sf::Music>
+ResourceManager::loadMusic(const std::string &file_name) {
+  return loadMusic(internMusic(file_name));
+}
+
+std::shared_ptr<sf::Font>
+ResourceManager::loadFont(const std::string &file_name) {
+  return loadFont(internFont(file_name));
+}
+
+std::shared_ptr<Scene>
+ResourceManager::loadScene(const std::string &file_name) {
+  return loadScene(internScene(file_name));
+}
+
+void ResourceManager::releaseTexture(AssetId id) {
+  pending_textures_.erase(id);
+  textures_.release(id);
+}
 
-  if (!exists<nlohmann::json::value_t::number_integer>(config, "font_size")) {
-    config["font_size"] = 24;
+void ResourceManager::releaseMusic(AssetId id) { pieces_of_music_.release(id); }
+
+void ResourceManager::releaseSound(AssetId id) {
+  auto &slot = sounds_[id];
+  if (slot.data != nullptr) {
+    sound_bytes_ -= slot.info.bytes;
   }
+  pending_sounds_.erase(id);
+  sounds_.release(id);
+}
+
+void ResourceManager::releaseFont(AssetId id) { fonts_.release(id); }
+
+void ResourceManager::releaseScene(AssetId id) { scenes_.release(id); }
 
-  if (exists<nlohmann::json::value_t::object>(config, "main_dialog")) {
-    scene->main_dialog = std::unique_ptr<Dialog>{dynamic_cast<Dialog *>(
-        factory.from(config["main_dialog"], config).release())};
+void ResourceManager::retain(const AssetSet &assets) {
+  // dropping a pending texture also cancels its upload
+  std::erase_if(pending_textures_, [&](const auto &pending) {
+    return assets.textures.count(pending.first) == 0;
+  });
+  stats_.unloaded += unloadExcept(textures_, assets.textures);
+  stats_.unloaded += unloadExcept(pieces_of_music_, assets.music);
+  stats_.unloaded += unloadExcept(fonts_, assets.fonts);
+  stats_.unloaded += unloadExcept(scenes_, assets.scenes);
+}
+
+const CacheStats &ResourceManager::stats() const { return stats_; }
+
+const std::filesystem::path &
+ResourceManager::prefix(const std::string &name) const {
+  static const std::filesystem::path none;
+  auto it = prefixes.find(name);
+  return it == prefixes.end() ? none : it->second;
+}
+
+ResourceManager::CompiledScene
+ResourceManager::compileScene(const std::string &file_name,
+                              const std::string &path) {
+  CompiledScene compiled;
+
+  // prefer the output of sakura-cook if it is up to date
+  std::error_code ec;
+  auto binary_path = compiledScenePath(path);
+  auto binary_time = std::filesystem::last_write_time(binary_path, ec);
+  bool loaded = false;
+  if (!ec) {
+    auto source_time = std::filesystem::last_write_time(path, ec);
+    std::ifstream binary(binary_path, std::ios::binary);
+    loaded = (ec || source_time <= binary_time) && binary.is_open() &&
+             SceneProto::load(binary, compiled.proto);
   }
 
-  if (exists<nlohmann::json::value_t::object>(config, "selector")) {
-    auto selector = config["selector"];
-    if (!exists<nlohmann::json::value_t::object>(selector, "first") ||
-        !exists<nlohmann::json::value_t::object>(selector, "second")) {
+  if (!loaded) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
       throw std::runtime_error(
-          fmt::format("{}: expects both selectors configuration", file_name));
+          fmt::format("{}: can't open scene config file", file_name));
     }
-    scene->selectors.first =
-        std::unique_ptr<PushButton>{dynamic_cast<PushButton *>(
-            factory.from(selector["first"], config).release())};
-    scene->selectors.second =
-        std::unique_ptr<PushButton>{dynamic_cast<PushButton *>(
-            factory.from(selector["second"], config).release())};
+    nlohmann::json config;
+    file >> config;
+    compiled.proto = SceneProto::compile(config, file_name);
   }
 
-  for (auto &widget : config["widgets"]) {
-    scene->widgets.push_back(factory.from(widget, config));
+  compiled.font = internFont(compiled.proto.font_face);
+  compiled.textures.reserve(compiled.proto.textures.size());
+  for (auto &texture : compiled.proto.textures) {
+    compiled.textures.push_back(internTexture(texture));
   }
-
-  scenes_[file_name] = scene;
-  return scene;
+  compiled.texture_sizes.resize(compiled.textures.size());
+  for (auto &widget : compiled.proto.widgets) {
+    if (widget.texture != SceneProto::NONE) {
+      auto &size = compiled.texture_sizes[widget.texture];
+      size.x = std::max(size.x, widget.shape.width);
+      size.y = std::max(size.y, widget.shape.height);
+    }
+  }
+  return compiled;
 }
 
 } // namespace sakura
@@ -1,31 +1,203 @@
 #ifndef SAKURA_RESOURCE_MANAGER_H
 #define SAKURA_RESOURCE_MANAGER_H
 
+#include "asset_table.h"
+#include "job_system.h"
 #include "scene.h"
+#include "scene_proto.h"
 #include <SFML/Audio.hpp>
 #include <SFML/Graphics.hpp>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace sakura {
 
+struct CacheStats {
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  // assets whose content is already loaded under another name
+  std::size_t deduplicated = 0;
+  // memory not spent on them: decoded pixels for textures, file size for fonts
+  std::size_t deduplicated_bytes = 0;
+  // assets dropped to bound memory, see `ResourceManager::retain` and
+  // `ResourceManager::loadSound`
+  std::size_t unloaded = 0;
+};
+
+struct AssetSet {
+  std::unordered_set<AssetId> textures;
+  std::unordered_set<AssetId> music;
+  std::unordered_set<AssetId> fonts;
+  std::unordered_set<AssetId> scenes;
+};
+
 class ResourceManager {
 public:
-  std::shared_ptr<sf::Texture> loadTexture(const std::string &file_name);
+  // Decoding runs on `jobs`, which must outlive the manager.
+  explicit ResourceManager(JobSystem &jobs);
+
+  // Reads the content hashes recorded by sakura-cook, so that duplicated
+  // assets are recognized without reading them.
+  void loadManifest(const std::filesystem::path &path);
+
+  // Resolve a file name to a handle. Call them once when scripts and scenes
+  // are compiled, every later access should go through the handle.
+  AssetId internTexture(const std::string &file_name);
+  AssetId internMusic(const std::string &file_name);
+  AssetId internSound(const std::string &file_name);
+  AssetId internFont(const std::string &file_name);
+  AssetId internScene(const std::string &file_name);
+
+  // A texture shown at `display_size` design units, or at its native size if
+  // it is {0, 0}, may be downscaled to a coarser tier. See `designSize`.
+  // A finer tier replaces the cached one, so whatever draws the texture holds
+  // the returned pointer.
+  std::shared_ptr<sf::Texture> loadTexture(AssetId id,
+                                           sf::Vector2f display_size = {});
+  std::shared_ptr<sf::Music> loadMusic(AssetId id);
+  // Sound buffers are cached within `sound_budget`, the least recently used
+  // ones which are not playing are dropped first.
+  std::shared_ptr<sf::SoundBuffer> loadSound(AssetId id);
+  std::shared_ptr<sf::Font> loadFont(AssetId id);
+  // The bytes of the file a font returned by `loadFont` was loaded from, null
+  // for any other font.
+  std::shared_ptr<const std::vector<char>>
+  fontBytes(const sf::Font &font) const;
+  // Every call returns a fresh scene, only the compiled prototype is cached.
+  std::shared_ptr<Scene> loadScene(AssetId id);
+
+  // Slow path, looks the file name up on every call.
+  std::shared_ptr<sf::Texture> loadTexture(const std::string &file_name,
+                                           sf::Vector2f display_size = {});
   std::shared_ptr<sf::Music> loadMusic(const std::string &file_name);
   std::shared_ptr<sf::Font> loadFont(const std::string &file_name);
   std::shared_ptr<Scene> loadScene(const std::string &file_name);
 
+  // Decode and downscale the texture in the background, then upload it
+  // from `JobSystem::pump`, unless `loadTexture` needs it first.
+  void prefetchTexture(AssetId id, sf::Vector2f display_size = {});
+  // Decode the sound on a worker thread, ahead of other prefetching.
+  void prefetchSound(AssetId id);
+  // Opens a new stream of the music on a worker thread, so that it can be
+  // played while another stream of it fades out.
+  Job<std::shared_ptr<sf::Music>> openMusic(AssetId id);
+  // Compile the scene and prefetch its textures.
+  void prefetchScene(AssetId id);
+
+  // Compiles the scene if needed, without instantiating it.
+  const SceneProto &sceneProto(AssetId id);
+
+  // The size of a loaded texture in design units, which is the size of the
+  // source image whatever tier has been loaded.
+  sf::Vector2f designSize(AssetId id) const;
+
+  // Drop the asset, every handle to it becomes stale.
+  void releaseTexture(AssetId id);
+  void releaseMusic(AssetId id);
+  void releaseSound(AssetId id);
+  void releaseFont(AssetId id);
+  void releaseScene(AssetId id);
+
+  // Unload every asset which is not in `assets`. Unlike `release*` the
+  // handles stay valid, the asset is loaded again when it is used. Objects
+  // still referring to an unloaded asset keep it alive.
+  void retain(const AssetSet &assets);
+
+  const std::filesystem::path &prefix(const std::string &name) const;
+  const CacheStats &stats() const;
+
 public:
+  // A content hash recorded by sakura-cook, trusted only while the size and
+  // modification time of the file are the recorded ones.
+  struct ManifestEntry {
+    std::uint64_t hash = 0;
+    std::uintmax_t size = 0;
+    std::int64_t time = 0;
+  };
+
   std::unordered_map<std::string, std::filesystem::path> prefixes;
+  // window pixels per design unit
+  float pixel_ratio = 1.0f;
+  // bytes of decoded samples
+  std::size_t sound_budget = 64 << 20;
+
+private:
+  struct TextureInfo {
+    sf::Vector2u source_size;
+    unsigned tier = 0;
+  };
+
+  struct PreparedTexture {
+    std::vector<std::uint8_t> pixels;
+    sf::Vector2u size;
+    TextureInfo info;
+    std::uint64_t content_hash = 0;
+  };
+
+  struct TextureContent {
+    std::weak_ptr<sf::Texture> texture;
+    TextureInfo info;
+  };
+
+  static PreparedTexture prepareTexture(const std::string &path,
+                                        sf::Vector2f display_size,
+                                        float pixel_ratio);
+  std::shared_ptr<sf::Texture> findTexture(std::uint64_t hash,
+                                           sf::Vector2f display_size,
+                                           TextureInfo &info);
+
+  struct SoundInfo {
+    std::size_t bytes = 0;
+    std::uint64_t last_used = 0;
+  };
+
+  struct PreparedSound {
+    std::vector<sf::Int16> samples;
+    unsigned channel_count = 0;
+    unsigned sample_rate = 0;
+  };
+
+  static PreparedSound prepareSound(const std::string &path);
+  void trimSounds(AssetId keep);
+
+  struct CompiledScene {
+    SceneProto proto;
+    std::vector<AssetId> textures;
+    // the largest size each texture is shown at
+    std::vector<sf::Vector2f> texture_sizes;
+    AssetId font = INVALID_ASSET;
+  };
+
+  CompiledScene compileScene(const std::string &file_name,
+                             const std::string &path);
+  const std::shared_ptr<CompiledScene> &compiledScene(AssetId id);
 
 private:
-  std::unordered_map<std::string, std::shared_ptr<sf::Texture>> textures_;
-  std::unordered_map<std::string, std::shared_ptr<sf::Music>> pieces_of_music_;
-  std::unordered_map<std::string, std::shared_ptr<sf::Font>> fonts_;
-  std::unordered_map<std::string, std::shared_ptr<Scene>> scenes_;
+  AssetTable<sf::Texture, TextureInfo> textures_;
+  AssetTable<sf::Music> pieces_of_music_;
+  AssetTable<sf::SoundBuffer, SoundInfo> sounds_;
+  AssetTable<sf::Font> fonts_;
+  AssetTable<CompiledScene> scenes_;
+  // loaded assets by content hash
+  std::unordered_map<std::uint64_t, TextureContent> texture_contents_;
+  std::unordered_map<std::uint64_t, std::weak_ptr<sf::Font>> font_contents_;
+  // by font, as long as it is alive
+  std::unordered_map<const sf::Font *, std::weak_ptr<const std::vector<char>>>
+      font_bytes_;
+  // content hashes from the manifest by file name
+  std::unordered_map<std::string, ManifestEntry> texture_hashes_;
+  std::unordered_map<std::string, ManifestEntry> font_hashes_;
+  JobSystem &jobs_;
+  std::unordered_map<AssetId, Job<PreparedTexture>> pending_textures_;
+  std::unordered_map<AssetId, Job<PreparedSound>> pending_sounds_;
+  std::size_t sound_bytes_ = 0;
+  std::uint64_t sound_clock_ = 0;
+  CacheStats stats_;
 };
 
 } // namespace sakura
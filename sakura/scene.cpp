@@ -1,63 +1,192 @@
 #include "scene.h"
+#include "widget_factory.h"
 
 namespace sakura {
 
-void Scene::render(sf::RenderTarget &render_target) const {
-  for (auto &widget : widgets) {
-    widget->render(render_target);
+std::shared_ptr<Scene>
+Scene::instantiate(const SceneProto &proto,
+                   std::vector<std::shared_ptr<sf::Texture>> textures,
+                   std::shared_ptr<sf::Font> font) {
+  auto scene = std::make_shared<Scene>();
+  scene->textures = std::move(textures);
+  scene->font = std::move(font);
+  WidgetFactory factory(proto, scene->textures, *scene->font);
+  for (auto root : proto.roots) {
+    factory.add(scene->widgets, root);
   }
-  if (main_dialog != nullptr) {
-    main_dialog->render(render_target);
+  if (proto.main_dialog != SceneProto::NONE) {
+    scene->main_dialog = factory.createDialog(proto.main_dialog);
+    factory.add(scene->widgets, proto.main_dialog);
   }
-  if (selected) {
-    if (selectors.first) {
-      selectors.first->render(render_target);
-    }
-    if (selectors.second) {
-      selectors.second->render(render_target);
-    }
+  scene->frames_end_ = scene->widgets.size();
+  scene->widgets.index(0, scene->frames_end_);
+  if (proto.first_selector != SceneProto::NONE) {
+    auto &widgets = scene->widgets;
+    scene->selectors = {
+        widgets.buttons[factory.add(widgets, proto.first_selector)],
+        widgets.buttons[factory.add(widgets, proto.second_selector)]};
   }
+  return scene;
 }
 
-std::string Scene::on(const sf::Event &event) {
-  std::string action;
-  if (selected) {
-    action = selectors.first->on(event);
-    if (action.empty()) {
-      action = selectors.second->on(event);
+void Scene::record(DrawList &list, const sf::RenderTarget &target,
+                   Layers &layers) const {
+  for (std::size_t i = 0; i < LAYER_COUNT; ++i) {
+    if (std::exchange(dirty_[i], false)) {
+      layers[i].invalidate();
     }
-    if (!action.empty()) {
-      selected = false;
+  }
+
+  // layers which can't be composited are recorded as they are
+  if (!layers[FRAMES].record(list, target, widgets.bounds(0, frames_end_),
+                             [this](sf::RenderTarget &target) {
+                               widgets.render(target, 0, frames_end_);
+                             })) {
+    widgets.record(list, 0, frames_end_);
+  }
+
+  if (main_dialog != nullptr) {
+    if (!layers[NAME].record(list, target,
+                             main_dialog->name.getGlobalBounds(),
+                             [this](sf::RenderTarget &target) {
+                               target.draw(main_dialog->name);
+                             })) {
+      list.addText(main_dialog->name);
     }
-  } else {
-    if (main_dialog) {
-      action = main_dialog->on(event);
+    if (!main_dialog->text.finished() ||
+        !layers[TEXT].record(list, target,
+                             main_dialog->text.getGlobalBounds(),
+                             [this](sf::RenderTarget &target) {
+                               target.draw(main_dialog->text);
+                             })) {
+      // while revealing it changes every frame, caching would only add a
+      // pass
+      main_dialog->text.record(list, {});
     }
-    if (action.empty()) {
-      for (auto &widget : widgets) {
-        action = widget->on(event);
-        if (!action.empty()) {
-          break;
-        }
+  }
+
+  if (selected && selectors.first != WidgetStore::NONE &&
+      !layers[SELECTORS].record(list, target,
+                                widgets.bounds(frames_end_, widgets.size()),
+                                [this](sf::RenderTarget &target) {
+                                  widgets.render(target, frames_end_,
+                                                 widgets.size());
+                                })) {
+    widgets.record(list, frames_end_, widgets.size());
+  }
+}
+
+std::uint32_t Scene::buttonAt(sf::Vector2f point) const {
+  if (selected) {
+    for (auto button : {selectors.first, selectors.second}) {
+      if (widgets.contains(button, point)) {
+        return button;
       }
     }
+    return WidgetStore::NONE;
+  }
+  return widgets.buttonAt(point);
+}
+
+bool Scene::setState(std::uint32_t button, WidgetStore::State state) {
+  if (button == WidgetStore::NONE || !widgets.setState(button, state)) {
+    return false;
+  }
+  bool selector = button == selectors.first || button == selectors.second;
+  dirty_[selector ? SELECTORS : FRAMES] = true;
+  return true;
+}
+
+std::string Scene::press(sf::Vector2f point) {
+  auto button = buttonAt(point);
+  if (button == WidgetStore::NONE) {
+    return {};
+  }
+  setState(button, WidgetStore::PRESSED);
+  pressed_ = button;
+  const auto &action = widgets.actions[button][WidgetProto::CLICKED];
+  if (!action.empty() && selected) {
+    selected = false;
+    setState(selectors.first, WidgetStore::NORMAL);
+    setState(selectors.second, WidgetStore::NORMAL);
+    hovered_ = pressed_ = WidgetStore::NONE;
   }
   return action;
 }
 
-void Scene::select(const std::string &first_selector_text,
+bool Scene::release() {
+  auto button = std::exchange(pressed_, WidgetStore::NONE);
+  return setState(button, button == hovered_ ? WidgetStore::HOVERED
+                                             : WidgetStore::NORMAL);
+}
+
+bool Scene::hover(sf::Vector2f point) {
+  auto button = buttonAt(point);
+  if (button == hovered_) {
+    return false;
+  }
+  bool changed = false;
+  if (hovered_ != pressed_) {
+    changed = setState(hovered_, WidgetStore::NORMAL);
+  }
+  hovered_ = button;
+  if (button != pressed_) {
+    changed = setState(button, WidgetStore::HOVERED) || changed;
+  }
+  return changed;
+}
+
+void Scene::say(std::u32string_view name, std::u32string_view text,
+                TextLayouter &layouter) {
+  main_dialog->setName(name);
+  auto size = main_dialog->text.getCharacterSize();
+  main_dialog->setText(
+      *layouter.layout(font, size, text, main_dialog->textWidth()),
+      layouter.glyphs(font, size));
+  dirty_[NAME] = true;
+  dirty_[TEXT] = true;
+}
+
+void Scene::update(sf::Time elapsed) {
+  if (main_dialog != nullptr) {
+    main_dialog->text.update(elapsed);
+  }
+}
+
+bool Scene::revealing() const {
+  return main_dialog != nullptr && !main_dialog->text.finished();
+}
+
+void Scene::completeReveal() {
+  if (main_dialog != nullptr) {
+    main_dialog->text.complete();
+  }
+}
+
+void Scene::invalidate() {
+  dirty_.fill(true);
+}
+
+void Scene::select(std::u32string_view first_selector_text,
                    const std::string &first_selector_action,
-                   const std::string &second_selector_text,
+                   std::u32string_view second_selector_text,
                    const std::string &second_selector_action) {
-  if (selectors.first == nullptr || selectors.second == nullptr) {
+  if (selectors.first == WidgetStore::NONE) {
     // TODO: say something
     return;
   }
   selected = true;
-  selectors.first->setText(first_selector_text);
-  selectors.first->actions["clicked"] = first_selector_action;
-  selectors.second->setText(second_selector_text);
-  selectors.second->actions["clicked"] = second_selector_action;
+  // the hover of the buttons underneath must not stick
+  setState(hovered_, WidgetStore::NORMAL);
+  setState(pressed_, WidgetStore::NORMAL);
+  hovered_ = pressed_ = WidgetStore::NONE;
+  widgets.setLabel(selectors.first, first_selector_text);
+  widgets.actions[selectors.first][WidgetProto::CLICKED] =
+      first_selector_action;
+  widgets.setLabel(selectors.second, second_selector_text);
+  widgets.actions[selectors.second][WidgetProto::CLICKED] =
+      second_selector_action;
+  dirty_[SELECTORS] = true;
 }
 
 } // namespace sakura
@@ -1,27 +1,85 @@
 #ifndef SAKURA_SCENE_H
 #define SAKURA_SCENE_H
 
+#include "cached_layer.h"
+#include "scene_proto.h"
+#include "text_layout.h"
 #include "widget.h"
+#include "widget_store.h"
 #include <SFML/Graphics.hpp>
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 namespace sakura {
 
 struct Scene {
-  void render(sf::RenderTarget &render_target) const;
-  std::string on(const sf::Event &event);
-  void select(const std::string &first_selector_text,
+  enum Layer { FRAMES, NAME, TEXT, SELECTORS, LAYER_COUNT };
+  // FRAMES: the widgets and the frame of the main dialog
+  // NAME: the name of the speaker in the main dialog
+  // TEXT: the text of the main dialog, once it is revealed
+  // SELECTORS: both selectors while selecting
+  // Owned by the engine and reused by every scene it records, so that a
+  // scene switch doesn't allocate render textures.
+  using Layers = std::array<CachedLayer, LAYER_COUNT>;
+
+  static std::shared_ptr<Scene>
+  instantiate(const SceneProto &proto,
+              std::vector<std::shared_ptr<sf::Texture>> textures,
+              std::shared_ptr<sf::Font> font);
+
+  // Widgets are composited into `layers`, call `invalidate` after changing
+  // them other than by `say` and `select`. A new scene paints every layer
+  // again on its first record. `target` is what the list will be drawn on.
+  // The list copies or keeps alive everything it draws, so the scene may
+  // change before it is drawn. Call it holding `gpuMutex`.
+  void record(DrawList &list, const sf::RenderTarget &target,
+              Layers &layers) const;
+  // Mouse input in design units. `press` returns the action of the button
+  // clicked, if any, the others whether the scene must be redrawn. Only the
+  // selectors react while selecting.
+  std::string press(sf::Vector2f point);
+  bool release();
+  bool hover(sf::Vector2f point);
+  // Starts revealing `text` in the main dialog, wrapped to its width.
+  void say(std::u32string_view name, std::u32string_view text,
+           TextLayouter &layouter);
+  void update(sf::Time elapsed);
+  bool revealing() const;
+  // Shows the rest of the text at once.
+  void completeReveal();
+  void select(std::u32string_view first_selector_text,
               const std::string &first_selector_action,
-              const std::string &second_selector_text,
+              std::u32string_view second_selector_text,
               const std::string &second_selector_action);
+  void invalidate();
 
   bool selected = false;
+  // every widget, the main dialog and its buttons after the others and the
+  // selectors last
+  WidgetStore widgets;
   std::unique_ptr<Dialog> main_dialog;
-  std::pair<std::unique_ptr<PushButton>, std::unique_ptr<PushButton>> selectors;
-  std::vector<std::unique_ptr<Widget>> widgets;
+  // buttons of `widgets`, NONE if the scene has no selectors
+  std::pair<std::uint32_t, std::uint32_t> selectors{WidgetStore::NONE,
+                                                    WidgetStore::NONE};
+  // the widgets refer to them
+  std::vector<std::shared_ptr<sf::Texture>> textures;
+  std::shared_ptr<sf::Font> font;
+
+private:
+  std::uint32_t buttonAt(sf::Vector2f point) const;
+  bool setState(std::uint32_t button, WidgetStore::State state);
+
+  // layers to paint again before they are recorded
+  mutable std::array<bool, LAYER_COUNT> dirty_{true, true, true, true};
+  // the widgets before it are in FRAMES, the selectors after
+  std::uint32_t frames_end_ = 0;
+  std::uint32_t hovered_ = WidgetStore::NONE;
+  std::uint32_t pressed_ = WidgetStore::NONE;
 };
 
 } // namespace sakura
@@ -0,0 +1,457 @@
+#include "scene_proto.h"
+#include "utility.h"
+#include <algorithm>
+#include <cstring>
+#include <fmt/core.h>
+#include <stdexcept>
+
+namespace sakura {
+
+namespace {
+
+constexpr std::uint16_t COMPILED_SCENE_VERSION = 2;
+
+class SceneCompiler {
+public:
+  SceneCompiler(SceneProto &proto, const std::string &file_name)
+      : proto_(proto), file_name_(file_name) {}
+
+  std::uint32_t add(const nlohmann::json &config) {
+    auto index = static_cast<std::uint32_t>(proto_.widgets.size());
+    proto_.widgets.emplace_back();
+    fill(index, config);
+    return index;
+  }
+
+private:
+  std::uint32_t intern(const std::string &texture) {
+    for (std::uint32_t i = 0; i < proto_.textures.size(); ++i) {
+      if (proto_.textures[i] == texture) {
+        return i;
+      }
+    }
+    proto_.textures.push_back(texture);
+    return static_cast<std::uint32_t>(proto_.textures.size() - 1);
+  }
+
+  void fill(std::uint32_t index, const nlohmann::json &config) {
+    std::string type;
+    if (exists<nlohmann::json::value_t::string>(config, "class")) {
+      type = config["class"].get<std::string>();
+    } else {
+      throw std::runtime_error(
+          fmt::format("{}: empty widget class name", file_name_));
+    }
+    WidgetProto widget;
+    if (type == "push_button") {
+      widget.type = WidgetProto::PUSH_BUTTON;
+      fillPushButton(widget, config);
+    } else if (type == "dialog") {
+      widget.type = WidgetProto::DIALOG;
+      fillDialog(widget, config);
+    } else {
+      throw std::runtime_error(
+          fmt::format("{}: {}: invalid widget type", file_name_, type));
+    }
+    proto_.widgets[index] = std::move(widget);
+  }
+
+  void fillShape(WidgetProto &widget, const nlohmann::json &shape) {
+    // TODO: check "left", "top" and so on
+    widget.shape = {shape["left"].get<float>(), shape["top"].get<float>(),
+                    shape["width"].get<float>(), shape["height"].get<float>()};
+    if (exists<nlohmann::json::value_t::string>(shape, "texture")) {
+      widget.texture = intern(shape["texture"].get<std::string>());
+    }
+  }
+
+  // PushButton:
+  // {
+  //   "class": "push_button",
+  //   "shape": {
+  //     "left": number,
+  //     "top": number,
+  //     "width": number,
+  //     "height": number,
+  //     "texture": <optional> string
+  //   },
+  //   "text": <optional> string,
+  //   "actions": {
+  //     <optional> "clicked": string
+  //   }
+  // }
+  void fillPushButton(WidgetProto &widget, const nlohmann::json &config) {
+    if (!exists<nlohmann::json::value_t::object>(config, "shape")) {
+      throw std::runtime_error(fmt::format(
+          "{}: <Anonymous PushButton>: expects shape configuration",
+          file_name_));
+    }
+    fillShape(widget, config["shape"]);
+    if (exists<nlohmann::json::value_t::string>(config, "text")) {
+      widget.text = config["text"].get<std::string>();
+    }
+    if (exists<nlohmann::json::value_t::object>(config, "actions")) {
+      for (auto &action : config["actions"].items()) {
+        auto name = std::find(std::begin(WidgetProto::EVENT_NAMES),
+                              std::end(WidgetProto::EVENT_NAMES), action.key());
+        if (name == std::end(WidgetProto::EVENT_NAMES)) {
+          throw std::runtime_error(
+              fmt::format("{}: <Anonymous PushButton>: unknown event '{}'",
+                          file_name_, action.key()));
+        }
+        widget.actions[name - std::begin(WidgetProto::EVENT_NAMES)] =
+            action.value().get<std::string>();
+      }
+    }
+  }
+
+  // Dialog:
+  // {
+  //   "class": "dialog",
+  //   "shape": {
+  //     "left": number,
+  //     "right": number,
+  //     "width": number,
+  //     "height": number,
+  //     "texture": <optional> string
+  //   },
+  //   "text": {
+  //     "left": number,
+  //     "top": number
+  //   },
+  //   "name": {
+  //     "left": number,
+  //     "top": number
+  //   },
+  //   "children": [
+  //     <optional>
+  //   ]
+  // }
+  void fillDialog(WidgetProto &widget, const nlohmann::json &config) {
+    if (!exists<nlohmann::json::value_t::object>(config, "shape")) {
+      throw std::runtime_error(fmt::format(
+          "{}: <Anonymous Dialog>: expects shape configuration", file_name_));
+    }
+    if (!exists<nlohmann::json::value_t::object>(config, "text")) {
+      throw std::runtime_error(fmt::format(
+          "{}: <Anonymous Dialog>: expects text configuration", file_name_));
+    }
+    if (!exists<nlohmann::json::value_t::object>(config, "name")) {
+      throw std::runtime_error(fmt::format(
+          "{}: <Anonymous Dialog>: expects name configuration", file_name_));
+    }
+    fillShape(widget, config["shape"]);
+
+    const auto &text = config["text"];
+    const auto &name = config["name"];
+    widget.text_position = {text["left"].get<float>(),
+                            text["top"].get<float>()};
+    widget.name_position = {name["left"].get<float>(),
+                            name["top"].get<float>()};
+
+    if (exists<nlohmann::json::value_t::array>(config, "children")) {
+      const auto &children = config["children"];
+      widget.first_child = static_cast<std::uint32_t>(proto_.widgets.size());
+      widget.child_count = static_cast<std::uint32_t>(children.size());
+      proto_.widgets.resize(proto_.widgets.size() + children.size());
+      for (std::uint32_t i = 0; i < widget.child_count; ++i) {
+        fill(widget.first_child + i, children[i]);
+      }
+    }
+  }
+
+private:
+  SceneProto &proto_;
+  const std::string &file_name_;
+};
+
+class BinaryWriter {
+public:
+  explicit BinaryWriter(std::ostream &stream) : stream_(stream) {}
+
+  template <typename T> void write(const T &value) {
+    stream_.write(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void write(const std::string &value) {
+    write(static_cast<std::uint32_t>(value.size()));
+    stream_.write(value.data(), static_cast<std::streamsize>(value.size()));
+  }
+
+private:
+  std::ostream &stream_;
+};
+
+// Sizes and counts read from a file are checked against the bytes left in it
+// before anything is allocated, so that a corrupt file fails to load rather
+// than asking for gigabytes.
+class BinaryReader {
+public:
+  // without a seekable stream, the most a compiled scene may take
+  static constexpr std::uint64_t MAX_BYTES = 64u << 20;
+
+  explicit BinaryReader(std::istream &stream) : stream_(stream) {
+    auto begin = stream_.tellg();
+    if (begin != std::istream::pos_type(-1) &&
+        stream_.seekg(0, std::ios::end)) {
+      auto end = stream_.tellg();
+      stream_.seekg(begin);
+      if (end != std::istream::pos_type(-1) && end >= begin) {
+        left_ = std::min<std::uint64_t>(end - begin, MAX_BYTES);
+      }
+    }
+    stream_.clear(stream_.rdstate() & ~std::ios::failbit);
+  }
+
+  template <typename T> void read(T &value) {
+    if (!take(sizeof(T))) {
+      return;
+    }
+    stream_.read(reinterpret_cast<char *>(&value), sizeof(T));
+  }
+
+  void read(std::string &value) {
+    std::uint32_t size = 0;
+    read(size);
+    if (!take(size)) {
+      return;
+    }
+    value.resize(size);
+    stream_.read(value.data(), size);
+  }
+
+  // A count of elements taking at least `element_size` bytes each, 0 if
+  // they can't fit in what is left.
+  std::uint32_t readCount(std::size_t element_size) {
+    std::uint32_t count = 0;
+    read(count);
+    if (count > left_ / element_size) {
+      stream_.setstate(std::ios::failbit);
+      return 0;
+    }
+    return count;
+  }
+
+  bool good() const { return stream_.good(); }
+
+private:
+  bool take(std::uint64_t size) {
+    if (!stream_.good() || size > left_) {
+      stream_.setstate(std::ios::failbit);
+      return false;
+    }
+    left_ -= size;
+    return true;
+  }
+
+  std::istream &stream_;
+  std::uint64_t left_ = MAX_BYTES;
+};
+
+bool isConsistent(const SceneProto &proto) {
+  auto widget_count = proto.widgets.size();
+  auto is_widget = [&](std::uint32_t index) { return index < widget_count; };
+  for (std::uint32_t i = 0; i < widget_count; ++i) {
+    const auto &widget = proto.widgets[i];
+    if (widget.type != WidgetProto::PUSH_BUTTON &&
+        widget.type != WidgetProto::DIALOG) {
+      return false;
+    }
+    if (widget.texture != SceneProto::NONE &&
+        widget.texture >= proto.textures.size()) {
+      return false;
+    }
+    // children always follow their parent, which also rules out cycles
+    if (widget.child_count != 0 &&
+        (widget.first_child <= i ||
+         std::size_t{widget.first_child} + widget.child_count > widget_count)) {
+      return false;
+    }
+  }
+  for (auto root : proto.roots) {
+    if (!is_widget(root)) {
+      return false;
+    }
+  }
+  return (proto.main_dialog == SceneProto::NONE ||
+          (is_widget(proto.main_dialog) &&
+           proto.widgets[proto.main_dialog].type == WidgetProto::DIALOG)) &&
+         ((proto.first_selector == SceneProto::NONE &&
+           proto.second_selector == SceneProto::NONE) ||
+          (is_widget(proto.first_selector) &&
+           is_widget(proto.second_selector) &&
+           proto.widgets[proto.first_selector].type ==
+               WidgetProto::PUSH_BUTTON &&
+           proto.widgets[proto.second_selector].type ==
+               WidgetProto::PUSH_BUTTON));
+}
+
+} // namespace
+
+// Scene:
+// {
+//   "font_face": string,
+//   "font_size": <optional: 24> number,
+//   "main_dialog": <optional> Dialog,
+//   "selector": <optional> {
+//     "first": PushButton,
+//     "second": PushButton
+//   },
+//   "widgets": [
+//     <optional>
+//   ]
+// }
+
+SceneProto SceneProto::compile(const nlohmann::json &config,
+                               const std::string &file_name) {
+  SceneProto proto;
+  SceneCompiler compiler(proto, file_name);
+
+  if (!exists<nlohmann::json::value_t::string>(config, "font_face")) {
+    throw std::runtime_error(
+        fmt::format("{}: expects font_face configuration", file_name));
+  }
+  proto.font_face = config["font_face"].get<std::string>();
+
+  auto font_size = config.find("font_size");
+  if (font_size != config.end() && font_size->is_number_integer()) {
+    proto.font_size = font_size->get<unsigned>();
+  }
+
+  if (exists<nlohmann::json::value_t::object>(config, "main_dialog")) {
+    proto.main_dialog = compiler.add(config["main_dialog"]);
+  }
+
+  if (exists<nlohmann::json::value_t::object>(config, "selector")) {
+    const auto &selector = config["selector"];
+    if (!exists<nlohmann::json::value_t::object>(selector, "first") ||
+        !exists<nlohmann::json::value_t::object>(selector, "second")) {
+      throw std::runtime_error(
+          fmt::format("{}: expects both selectors configuration", file_name));
+    }
+    proto.first_selector = compiler.add(selector["first"]);
+    proto.second_selector = compiler.add(selector["second"]);
+  }
+
+  if (exists<nlohmann::json::value_t::array>(config, "widgets")) {
+    for (auto &widget : config["widgets"]) {
+      proto.roots.push_back(compiler.add(widget));
+    }
+  }
+
+  return proto;
+}
+
+// Compiled scene file (*.sksc):
+// {
+//   "magic": "SKSC",
+//   "version": u16,
+//   "font_face": string, "font_size": u32,
+//   "textures": u32 count, string...,
+//   "widgets": u32 count, Widget...,
+//   "roots": u32 count, u32...,
+//   "main_dialog": u32, "first_selector": u32, "second_selector": u32
+// }
+// where a string is a u32 length followed by UTF-8 bytes.
+
+bool SceneProto::save(std::ostream &stream) const {
+  BinaryWriter writer(stream);
+  stream.write("SKSC", 4);
+  writer.write(COMPILED_SCENE_VERSION);
+  writer.write(font_face);
+  writer.write(static_cast<std::uint32_t>(font_size));
+
+  writer.write(static_cast<std::uint32_t>(textures.size()));
+  for (auto &texture : textures) {
+    writer.write(texture);
+  }
+
+  writer.write(static_cast<std::uint32_t>(widgets.size()));
+  for (auto &widget : widgets) {
+    writer.write(widget.type);
+    writer.write(widget.shape);
+    writer.write(widget.texture);
+    writer.write(widget.text);
+    for (auto &action : widget.actions) {
+      writer.write(action);
+    }
+    writer.write(widget.text_position);
+    writer.write(widget.name_position);
+    writer.write(widget.first_child);
+    writer.write(widget.child_count);
+  }
+
+  writer.write(static_cast<std::uint32_t>(roots.size()));
+  for (auto root : roots) {
+    writer.write(root);
+  }
+  writer.write(main_dialog);
+  writer.write(first_selector);
+  writer.write(second_selector);
+  return stream.good();
+}
+
+bool SceneProto::load(std::istream &stream, SceneProto &proto) {
+  BinaryReader reader(stream);
+  char magic[4] = {};
+  std::uint16_t version = 0;
+  reader.read(magic);
+  reader.read(version);
+  if (!reader.good() || std::memcmp(magic, "SKSC", 4) != 0 ||
+      version != COMPILED_SCENE_VERSION) {
+    return false;
+  }
+
+  std::uint32_t count = 0;
+  reader.read(proto.font_face);
+  reader.read(count);
+  proto.font_size = count;
+
+  // strings take at least their size
+  proto.textures.resize(reader.readCount(sizeof(std::uint32_t)));
+  for (auto &texture : proto.textures) {
+    reader.read(texture);
+    if (!reader.good()) {
+      return false;
+    }
+  }
+
+  constexpr std::size_t MIN_WIDGET_SIZE =
+      sizeof(WidgetProto::Class) + sizeof(sf::FloatRect) +
+      sizeof(std::uint32_t) * (2 + WidgetProto::EVENT_COUNT) +
+      sizeof(sf::Vector2f) * 2 + sizeof(std::uint32_t) * 2;
+  proto.widgets.resize(reader.readCount(MIN_WIDGET_SIZE));
+  for (auto &widget : proto.widgets) {
+    reader.read(widget.type);
+    reader.read(widget.shape);
+    reader.read(widget.texture);
+    reader.read(widget.text);
+    for (auto &action : widget.actions) {
+      reader.read(action);
+    }
+    reader.read(widget.text_position);
+    reader.read(widget.name_position);
+    reader.read(widget.first_child);
+    reader.read(widget.child_count);
+    if (!reader.good()) {
+      return false;
+    }
+  }
+
+  proto.roots.resize(reader.readCount(sizeof(std::uint32_t)));
+  for (auto &root : proto.roots) {
+    reader.read(root);
+  }
+  reader.read(proto.main_dialog);
+  reader.read(proto.first_selector);
+  reader.read(proto.second_selector);
+  return reader.good() && isConsistent(proto);
+}
+
+std::filesystem::path compiledScenePath(const std::filesystem::path &source) {
+  auto path = source;
+  path += ".sksc";
+  return path;
+}
+
+} // namespace sakura
@@ -0,0 +1,65 @@
+#ifndef SAKURA_SCENE_PROTO_H
+#define SAKURA_SCENE_PROTO_H
+
+#include <SFML/Graphics.hpp>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sakura {
+
+// The immutable, JSON-free description of a scene. A scene config file is
+// compiled into a prototype once, and every use of the scene instantiates a
+// fresh `Scene` from it.
+
+struct WidgetProto {
+  enum Class : std::uint8_t { PUSH_BUTTON, DIALOG };
+  // events an action can be bound to, by their name in scene configs
+  enum Event : std::uint8_t { CLICKED, EVENT_COUNT };
+  static constexpr const char *EVENT_NAMES[EVENT_COUNT] = {"clicked"};
+
+  Class type = PUSH_BUTTON;
+  sf::FloatRect shape;
+  // index into `SceneProto::textures`
+  std::uint32_t texture = UINT32_MAX;
+  // PushButton
+  std::string text;
+  // script files by event, empty if unbound
+  std::array<std::string, EVENT_COUNT> actions;
+  // Dialog
+  sf::Vector2f text_position;
+  sf::Vector2f name_position;
+  // children are stored contiguously in `SceneProto::widgets`
+  std::uint32_t first_child = 0;
+  std::uint32_t child_count = 0;
+};
+
+struct SceneProto {
+  static constexpr std::uint32_t NONE = UINT32_MAX;
+
+  static SceneProto compile(const nlohmann::json &config,
+                            const std::string &file_name);
+  static bool load(std::istream &stream, SceneProto &proto);
+  bool save(std::ostream &stream) const;
+
+  std::string font_face;
+  unsigned font_size = 24;
+  // interned texture file names
+  std::vector<std::string> textures;
+  std::vector<WidgetProto> widgets;
+  std::vector<std::uint32_t> roots;
+  std::uint32_t main_dialog = NONE;
+  std::uint32_t first_selector = NONE;
+  std::uint32_t second_selector = NONE;
+};
+
+std::filesystem::path compiledScenePath(const std::filesystem::path &source);
+
+} // namespace sakura
+
+#endif // !SAKURA_SCENE_PROTO_H
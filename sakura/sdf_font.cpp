@@ -0,0 +1,400 @@
+#include "sdf_font.h"
+#include "gpu_lock.h"
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <fmt/core.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace sakura {
+
+namespace {
+
+constexpr float INF = 1e20f;
+constexpr unsigned INITIAL_HEIGHT = 256;
+// texels between two glyphs, so that linear filtering doesn't bleed
+constexpr unsigned GUTTER = 1;
+
+// Picks the layer of the glyph from the texture coordinates, which are in
+// [layer, layer + 1) across, then thresholds the distance at 0.5 with a
+// width of about one screen pixel, whatever the scale. The width comes from
+// the texture coordinates, which unlike the distances stay continuous where
+// a neighbouring fragment falls into another layer.
+constexpr char FRAGMENT_SHADER[] = R"(
+uniform sampler2D texture;
+uniform float layer_width;
+uniform float spread;
+
+void main() {
+  vec2 coords = gl_TexCoord[0].xy;
+  float layer = floor(coords.x);
+  vec4 texel = texture2D(texture, vec2(coords.x - layer, coords.y));
+  float distance = layer < 0.5 ? texel.r
+                 : layer < 1.5 ? texel.g
+                 : layer < 2.5 ? texel.b
+                 : texel.a;
+  float width = fwidth(coords.x) * layer_width / (2.0 * spread);
+  float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+  gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * alpha);
+}
+)";
+
+std::string familyName(const FT_FaceRec_ *face) {
+  return face->family_name != nullptr ? face->family_name : "";
+}
+
+struct DistanceTransform {
+  std::vector<float> f;
+  std::vector<float> d;
+  std::vector<std::size_t> v;
+  std::vector<float> z;
+
+  // Squared distances to the nearest zero along one row or column, after
+  // Felzenszwalb and Huttenlocher, O(n).
+  void line(float *grid, std::size_t n, std::size_t stride) {
+    f.resize(n);
+    d.resize(n);
+    v.resize(n);
+    z.resize(n + 1);
+    for (std::size_t q = 0; q < n; ++q) {
+      f[q] = grid[q * stride];
+    }
+    auto intersection = [&](std::size_t q, std::size_t p) {
+      auto fq = f[q] + static_cast<float>(q * q);
+      auto fp = f[p] + static_cast<float>(p * p);
+      return (fq - fp) / (2.0f * (static_cast<float>(q) - p));
+    };
+    std::size_t k = 0;
+    v[0] = 0;
+    z[0] = -INF;
+    z[1] = INF;
+    for (std::size_t q = 1; q < n; ++q) {
+      auto s = intersection(q, v[k]);
+      while (s <= z[k]) {
+        --k;
+        s = intersection(q, v[k]);
+      }
+      ++k;
+      v[k] = q;
+      z[k] = s;
+      z[k + 1] = INF;
+    }
+    k = 0;
+    for (std::size_t q = 0; q < n; ++q) {
+      while (z[k + 1] < static_cast<float>(q)) {
+        ++k;
+      }
+      auto offset = static_cast<float>(q) - static_cast<float>(v[k]);
+      d[q] = offset * offset + f[v[k]];
+    }
+    for (std::size_t q = 0; q < n; ++q) {
+      grid[q * stride] = d[q];
+    }
+  }
+
+  void operator()(std::vector<float> &grid, std::size_t width,
+                  std::size_t height) {
+    for (std::size_t x = 0; x < width; ++x) {
+      line(grid.data() + x, height, width);
+    }
+    for (std::size_t y = 0; y < height; ++y) {
+      line(grid.data() + y * width, width, 1);
+    }
+  }
+};
+
+} // namespace
+
+SdfFont::SdfFont(std::shared_ptr<const std::vector<char>> bytes)
+    : bytes_(std::move(bytes)) {
+  if (FT_Init_FreeType(&library_) != 0) {
+    throw std::runtime_error("can't initialize FreeType");
+  }
+  if (FT_New_Memory_Face(library_,
+                         reinterpret_cast<const FT_Byte *>(bytes_->data()),
+                         static_cast<FT_Long>(bytes_->size()), 0,
+                         &face_) != 0) {
+    FT_Done_FreeType(library_);
+    throw std::runtime_error("can't load font for distance field atlas");
+  }
+  if (FT_Select_Charmap(face_, FT_ENCODING_UNICODE) != 0 ||
+      FT_Set_Pixel_Sizes(face_, 0, BASE_SIZE) != 0) {
+    auto family = familyName(face_);
+    FT_Done_Face(face_);
+    FT_Done_FreeType(library_);
+    throw std::runtime_error(fmt::format(
+        "{}: no scalable Unicode glyphs for distance field atlas", family));
+  }
+  height_ = INITIAL_HEIGHT;
+  image_.resize(std::size_t{LAYER_WIDTH} * height_ * 4, 0);
+  texture_.setSmooth(true);
+  // nothing draws from it yet
+  if (!texture_.create(LAYER_WIDTH, height_)) {
+    FT_Done_Face(face_);
+    FT_Done_FreeType(library_);
+    throw std::runtime_error("can't create distance field atlas");
+  }
+  texture_.update(image_.data());
+}
+
+SdfFont::~SdfFont() {
+  FT_Done_Face(face_);
+  FT_Done_FreeType(library_);
+}
+
+// Glyphs are rasterized into `image_` without the lock, the render thread
+// only ever reads `texture_`.
+void SdfFont::prepare(const char32_t *begin, const char32_t *end) {
+  bool added = false;
+  for (auto it = begin; it != end; ++it) {
+    if (glyphs_.count(*it) == 0) {
+      glyphs_.emplace(*it, rasterize(*it));
+      added = true;
+    }
+  }
+  if (added) {
+    upload();
+  }
+}
+
+const sf::Glyph &SdfFont::glyph(char32_t code_point) {
+  auto it = glyphs_.find(code_point);
+  if (it == glyphs_.end()) {
+    prepare(&code_point, &code_point + 1);
+    it = glyphs_.find(code_point);
+  }
+  return it->second;
+}
+
+bool SdfFont::contains(char32_t code_point) const {
+  return glyphs_.count(code_point) != 0;
+}
+
+float SdfFont::kerning(char32_t first, char32_t second) {
+  auto key = static_cast<std::uint64_t>(first) << 32 | second;
+  auto it = kerning_.find(key);
+  if (it == kerning_.end()) {
+    float value = 0.0f;
+    FT_Vector kerning;
+    if (FT_HAS_KERNING(face_) &&
+        FT_Get_Kerning(face_, FT_Get_Char_Index(face_, first),
+                       FT_Get_Char_Index(face_, second), FT_KERNING_UNFITTED,
+                       &kerning) == 0) {
+      value = static_cast<float>(kerning.x) / 64.0f;
+    }
+    it = kerning_.emplace(key, value).first;
+  }
+  return it->second;
+}
+
+float SdfFont::lineSpacing() const {
+  return static_cast<float>(face_->size->metrics.height) / 64.0f;
+}
+
+const sf::Texture &SdfFont::texture() const { return texture_; }
+
+std::size_t SdfFont::textureBytes() const {
+  auto size = texture_.getSize();
+  return std::size_t{size.x} * size.y * 4;
+}
+
+std::size_t SdfFont::imageBytes() const { return image_.size(); }
+
+const sf::Shader *SdfFont::shader() {
+  static const sf::Shader *shader = []() -> const sf::Shader * {
+    if (!sf::Shader::isAvailable()) {
+      return nullptr;
+    }
+    static sf::Shader instance;
+    if (!instance.loadFromMemory(FRAGMENT_SHADER, sf::Shader::Fragment)) {
+      return nullptr;
+    }
+    instance.setUniform("texture", sf::Shader::CurrentTexture);
+    instance.setUniform("layer_width", static_cast<float>(LAYER_WIDTH));
+    instance.setUniform("spread", static_cast<float>(SPREAD));
+    return &instance;
+  }();
+  return shader;
+}
+
+sf::Glyph SdfFont::rasterize(char32_t code_point) {
+  sf::Glyph glyph;
+  // unhinted, so that every size scales the same outline
+  if (FT_Load_Char(face_, code_point, FT_LOAD_RENDER | FT_LOAD_NO_HINTING) !=
+      0) {
+    return glyph;
+  }
+  auto slot = face_->glyph;
+  glyph.advance = static_cast<float>(slot->linearHoriAdvance) / 65536.0f;
+  const auto &bitmap = slot->bitmap;
+  if (bitmap.width == 0 || bitmap.rows == 0 ||
+      bitmap.pixel_mode != FT_PIXEL_MODE_GRAY) {
+    return glyph;
+  }
+
+  // the coverage with `SPREAD` texels of margin, the distance fields are:
+  // squared distances to the inside from outside, and to the outside from
+  // inside, partly covered texels being half a texel from the outline
+  auto width = static_cast<std::size_t>(bitmap.width) + 2 * SPREAD;
+  auto height = static_cast<std::size_t>(bitmap.rows) + 2 * SPREAD;
+  std::vector<float> outside(width * height, INF);
+  std::vector<float> inside(width * height, 0.0f);
+  for (std::size_t y = 0; y < bitmap.rows; ++y) {
+    const auto *row =
+        bitmap.buffer + static_cast<std::ptrdiff_t>(y) * bitmap.pitch;
+    for (std::size_t x = 0; x < bitmap.width; ++x) {
+      auto coverage = row[x] / 255.0f;
+      auto i = (y + SPREAD) * width + x + SPREAD;
+      if (coverage >= 1.0f) {
+        outside[i] = 0.0f;
+        inside[i] = INF;
+      } else if (coverage > 0.0f) {
+        auto d = 0.5f - coverage;
+        outside[i] = d > 0.0f ? d * d : 0.0f;
+        inside[i] = d < 0.0f ? d * d : 0.0f;
+      }
+    }
+  }
+  DistanceTransform transform;
+  transform(outside, width, height);
+  transform(inside, width, height);
+
+  auto position = allocate(static_cast<unsigned>(width) + GUTTER,
+                           static_cast<unsigned>(height) + GUTTER);
+  auto layer = position.x / LAYER_WIDTH;
+  auto left = position.x % LAYER_WIDTH;
+  for (std::size_t y = 0; y < height; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      auto i = y * width + x;
+      auto distance = std::sqrt(outside[i]) - std::sqrt(inside[i]);
+      auto value = std::clamp(0.5f - distance / (2.0f * SPREAD), 0.0f, 1.0f);
+      auto texel = (position.y + y) * LAYER_WIDTH + left + x;
+      image_[texel * 4 + layer] =
+          static_cast<std::uint8_t>(std::lround(value * 255.0f));
+    }
+  }
+  if (dirty_right_ == 0) {
+    dirty_left_ = left;
+    dirty_top_ = position.y;
+  }
+  dirty_left_ = std::min(dirty_left_, left);
+  dirty_top_ = std::min(dirty_top_, position.y);
+  dirty_right_ =
+      std::max(dirty_right_, left + static_cast<unsigned>(width));
+  dirty_bottom_ =
+      std::max(dirty_bottom_, position.y + static_cast<unsigned>(height));
+
+  // the glyph quad covers the bitmap and its margin, in base pixels
+  glyph.bounds = {static_cast<float>(slot->bitmap_left) - SPREAD,
+                  -static_cast<float>(slot->bitmap_top) - SPREAD,
+                  static_cast<float>(width), static_cast<float>(height)};
+  glyph.textureRect = {static_cast<int>(position.x),
+                       static_cast<int>(position.y), static_cast<int>(width),
+                       static_cast<int>(height)};
+  return glyph;
+}
+
+// The layers are side by side, a glyph never straddles two of them.
+sf::Vector2u SdfFont::allocate(unsigned width, unsigned height) {
+  if (width > LAYER_WIDTH) {
+    throw std::runtime_error(fmt::format(
+        "{}: glyph too wide for distance field atlas", familyName(face_)));
+  }
+  auto layer_end = (shelf_x_ / LAYER_WIDTH + 1) * LAYER_WIDTH;
+  if (shelf_x_ + width > layer_end) {
+    shelf_x_ = layer_end;
+  }
+  if (shelf_x_ + width > LAYER_WIDTH * LAYERS) {
+    shelf_y_ += shelf_height_;
+    shelf_x_ = 0;
+    shelf_height_ = 0;
+  }
+  // texture coordinates are in texels, so the glyphs laid out so far stay
+  // valid when the atlas grows downwards
+  while (shelf_y_ + height > height_) {
+    if (height_ * 2 > sf::Texture::getMaximumSize()) {
+      throw std::runtime_error(fmt::format(
+          "{}: distance field atlas full", familyName(face_)));
+    }
+    height_ *= 2;
+    image_.resize(std::size_t{LAYER_WIDTH} * height_ * 4, 0);
+  }
+  sf::Vector2u position{shelf_x_, shelf_y_};
+  shelf_x_ += width;
+  shelf_height_ = std::max(shelf_height_, height);
+  return position;
+}
+
+// Uploads what has been rasterized since the last upload at once.
+void SdfFont::upload() {
+  if (dirty_right_ == 0) {
+    return;
+  }
+  // the render thread may be drawing from the atlas
+  std::lock_guard lock(gpuMutex());
+  if (texture_.getSize().y != height_) {
+    if (!texture_.create(LAYER_WIDTH, height_)) {
+      throw std::runtime_error(fmt::format(
+          "{}: distance field atlas full", familyName(face_)));
+    }
+    texture_.update(image_.data());
+  } else {
+    auto width = dirty_right_ - dirty_left_;
+    auto height = dirty_bottom_ - dirty_top_;
+    std::vector<std::uint8_t> texels(std::size_t{width} * height * 4);
+    for (unsigned y = 0; y < height; ++y) {
+      auto row = image_.begin() +
+                 ((std::size_t{dirty_top_} + y) * LAYER_WIDTH + dirty_left_) *
+                     4;
+      std::copy(row, row + std::size_t{width} * 4,
+                texels.begin() + std::size_t{y} * width * 4);
+    }
+    texture_.update(texels.data(), width, height, dirty_left_, dirty_top_);
+  }
+  dirty_left_ = dirty_top_ = dirty_right_ = dirty_bottom_ = 0;
+}
+
+SdfGlyphs::SdfGlyphs(SdfFont &font, unsigned character_size)
+    : font_(font), character_size_(character_size),
+      scale_(static_cast<float>(character_size) / SdfFont::BASE_SIZE) {}
+
+const sf::Glyph &SdfGlyphs::glyph(char32_t code_point) {
+  auto it = glyphs_.find(code_point);
+  if (it == glyphs_.end()) {
+    auto glyph = font_.glyph(code_point);
+    glyph.advance *= scale_;
+    glyph.bounds = {glyph.bounds.left * scale_, glyph.bounds.top * scale_,
+                    glyph.bounds.width * scale_, glyph.bounds.height * scale_};
+    it = glyphs_.emplace(code_point, glyph).first;
+  }
+  return it->second;
+}
+
+bool SdfGlyphs::contains(char32_t code_point) const {
+  return glyphs_.count(code_point) != 0;
+}
+
+void SdfGlyphs::prepare(const char32_t *begin, const char32_t *end) {
+  font_.prepare(begin, end);
+  GlyphSource::prepare(begin, end);
+}
+
+float SdfGlyphs::kerning(char32_t first, char32_t second) {
+  if (first == 0) {
+    return 0.0f;
+  }
+  return font_.kerning(first, second) * scale_;
+}
+
+float SdfGlyphs::lineSpacing() const { return font_.lineSpacing() * scale_; }
+
+unsigned SdfGlyphs::characterSize() const { return character_size_; }
+
+const sf::Texture &SdfGlyphs::texture() const { return font_.texture(); }
+
+const sf::Shader *SdfGlyphs::shader() const { return SdfFont::shader(); }
+
+} // namespace sakura
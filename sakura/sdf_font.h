@@ -0,0 +1,106 @@
+#ifndef SAKURA_SDF_FONT_H
+#define SAKURA_SDF_FONT_H
+
+#include "text_layout.h"
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+namespace sakura {
+
+// Glyphs of a font rasterized once at `BASE_SIZE` into a signed distance
+// field atlas, which `shader()` draws sharply at any size. The atlas holds
+// 0.5 on the outline, more inside, less outside, `SPREAD` base pixels away
+// reaching 1 or 0. Glyphs are rasterized on the CPU from the font file, so
+// no bitmap page is made for any size, and are packed in four layers, one
+// per channel of the atlas.
+class SdfFont {
+public:
+  static constexpr unsigned BASE_SIZE = 48;
+  static constexpr unsigned SPREAD = 6;
+  // the atlas is this wide, its layers side by side in texture coordinates
+  static constexpr unsigned LAYER_WIDTH = 1024;
+  static constexpr unsigned LAYERS = 4;
+
+  // `bytes` is the font file.
+  explicit SdfFont(std::shared_ptr<const std::vector<char>> bytes);
+  ~SdfFont();
+  SdfFont(const SdfFont &) = delete;
+  SdfFont &operator=(const SdfFont &) = delete;
+
+  // Adds the glyphs which are not in the atlas yet, uploading them together.
+  void prepare(const char32_t *begin, const char32_t *end);
+  // At `BASE_SIZE`, `textureRect` is in `texture()`, its layer being
+  // `textureRect.left / LAYER_WIDTH`.
+  const sf::Glyph &glyph(char32_t code_point);
+  bool contains(char32_t code_point) const;
+  // At `BASE_SIZE`.
+  float kerning(char32_t first, char32_t second);
+  float lineSpacing() const;
+
+  const sf::Texture &texture() const;
+  // The memory the atlas takes on the GPU, and its copy on the CPU, which
+  // lets glyphs be uploaded without overwriting the other layers.
+  std::size_t textureBytes() const;
+  std::size_t imageBytes() const;
+
+  // Shared by all fonts, null if shaders are not supported.
+  static const sf::Shader *shader();
+
+private:
+  sf::Glyph rasterize(char32_t code_point);
+  sf::Vector2u allocate(unsigned width, unsigned height);
+  void upload();
+
+private:
+  std::shared_ptr<const std::vector<char>> bytes_;
+  FT_LibraryRec_ *library_ = nullptr;
+  FT_FaceRec_ *face_ = nullptr;
+  std::unordered_map<char32_t, sf::Glyph> glyphs_;
+  std::unordered_map<std::uint64_t, float> kerning_;
+  sf::Texture texture_;
+  // RGBA, one layer per channel, `texture_` catches up with it in `upload`
+  std::vector<std::uint8_t> image_;
+  unsigned height_ = 0;
+  // the texels of `image_` not uploaded yet, none if `dirty_right_` is 0
+  unsigned dirty_left_ = 0;
+  unsigned dirty_top_ = 0;
+  unsigned dirty_right_ = 0;
+  unsigned dirty_bottom_ = 0;
+  // shelf packing across the layers side by side, the current shelf is the
+  // last one
+  unsigned shelf_x_ = 0;
+  unsigned shelf_y_ = 0;
+  unsigned shelf_height_ = 0;
+};
+
+// The glyphs of an `SdfFont` scaled to one size.
+class SdfGlyphs : public GlyphSource {
+public:
+  // `font` must outlive this.
+  SdfGlyphs(SdfFont &font, unsigned character_size);
+
+  const sf::Glyph &glyph(char32_t code_point) override;
+  bool contains(char32_t code_point) const override;
+  void prepare(const char32_t *begin, const char32_t *end) override;
+  float kerning(char32_t first, char32_t second) override;
+  float lineSpacing() const override;
+  unsigned characterSize() const override;
+  const sf::Texture &texture() const override;
+  const sf::Shader *shader() const override;
+
+private:
+  SdfFont &font_;
+  unsigned character_size_;
+  float scale_;
+  std::unordered_map<char32_t, sf::Glyph> glyphs_;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_SDF_FONT_H
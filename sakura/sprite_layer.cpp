@@ -0,0 +1,96 @@
+#include "sprite_layer.h"
+#include <algorithm>
+
+namespace sakura {
+
+void SpriteLayer::add(const std::string &name,
+                      std::shared_ptr<sf::Texture> texture, sf::FloatRect rect,
+                      int z) {
+  remove(name);
+  auto it = std::upper_bound(
+      sprites_.begin(), sprites_.end(), z,
+      [](int z, const Sprite &sprite) { return z < sprite.z; });
+  sprites_.insert(it, Sprite{name, std::move(texture), rect, z});
+  dirty_ = true;
+}
+
+bool SpriteLayer::remove(const std::string &name) {
+  auto it = std::find_if(sprites_.begin(), sprites_.end(),
+                         [&](const Sprite &sprite) { return sprite.name == name; });
+  if (it == sprites_.end()) {
+    return false;
+  }
+  sprites_.erase(it);
+  dirty_ = true;
+  return true;
+}
+
+void SpriteLayer::clear() {
+  sprites_.clear();
+  dirty_ = true;
+}
+
+std::size_t SpriteLayer::size() const { return sprites_.size(); }
+
+std::size_t SpriteLayer::batches() const {
+  if (dirty_) {
+    rebuild();
+  }
+  return batches_.size();
+}
+
+void SpriteLayer::rebuild() const {
+  vertices_.clear();
+  batches_.clear();
+  vertices_.reserve(sprites_.size() * 6);
+  for (auto &sprite : sprites_) {
+    auto size = sprite.texture->getSize();
+    auto &rect = sprite.rect;
+    sf::Vector2f tl{rect.left, rect.top};
+    sf::Vector2f tr{rect.left + rect.width, rect.top};
+    sf::Vector2f bl{rect.left, rect.top + rect.height};
+    sf::Vector2f br{rect.left + rect.width, rect.top + rect.height};
+    sf::Vector2f uv_tr{static_cast<float>(size.x), 0};
+    sf::Vector2f uv_bl{0, static_cast<float>(size.y)};
+    sf::Vector2f uv_br{static_cast<float>(size.x), static_cast<float>(size.y)};
+    vertices_.emplace_back(tl, sf::Vector2f{0, 0});
+    vertices_.emplace_back(tr, uv_tr);
+    vertices_.emplace_back(bl, uv_bl);
+    vertices_.emplace_back(bl, uv_bl);
+    vertices_.emplace_back(tr, uv_tr);
+    vertices_.emplace_back(br, uv_br);
+
+    if (batches_.empty() || batches_.back().texture != sprite.texture.get()) {
+      batches_.push_back({sprite.texture.get(), vertices_.size() - 6, 0});
+    }
+    batches_.back().count += 6;
+  }
+  dirty_ = false;
+}
+
+void SpriteLayer::record(DrawList &list, sf::RenderStates states) const {
+  if (dirty_) {
+    rebuild();
+  }
+  for (auto &batch : batches_) {
+    states.texture = batch.texture;
+    list.add(vertices_.data() + batch.first, batch.count, states);
+  }
+  for (auto &sprite : sprites_) {
+    list.retain(sprite.texture);
+  }
+}
+
+void SpriteLayer::draw(sf::RenderTarget &target,
+                       sf::RenderStates states) const {
+  if (dirty_) {
+    rebuild();
+  }
+  for (auto &batch : batches_) {
+    states.texture = batch.texture;
+    target.draw(vertices_.data() + batch.first, batch.count, sf::Triangles,
+                states);
+  }
+}
+
+} // namespace sakura
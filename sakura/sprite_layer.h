@@ -0,0 +1,61 @@
+#ifndef SAKURA_SPRITE_LAYER_H
+#define SAKURA_SPRITE_LAYER_H
+
+#include "draw_list.h"
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sakura {
+
+// Named sprites drawn in z order, sprites with the same z in the order they
+// were added. Consecutive sprites sharing a texture are drawn with one call.
+class SpriteLayer : public sf::Drawable {
+public:
+  // `rect` is the position and the size in design units, the texture is
+  // stretched over it whatever its tier. Replaces a sprite of the same name.
+  void add(const std::string &name, std::shared_ptr<sf::Texture> texture,
+           sf::FloatRect rect, int z = 0);
+  bool remove(const std::string &name);
+  void clear();
+
+  std::size_t size() const;
+  // draw calls per frame
+  std::size_t batches() const;
+  // Appends the batches to `list`, which keeps the textures alive.
+  void record(DrawList &list, sf::RenderStates states) const;
+
+protected:
+  void draw(sf::RenderTarget &target, sf::RenderStates states) const override;
+
+private:
+  struct Sprite {
+    std::string name;
+    std::shared_ptr<sf::Texture> texture;
+    sf::FloatRect rect;
+    int z = 0;
+  };
+
+  struct Batch {
+    const sf::Texture *texture;
+    std::size_t first;
+    std::size_t count;
+  };
+
+  void rebuild() const;
+
+private:
+  // sorted by z, stable
+  std::vector<Sprite> sprites_;
+  // two triangles per sprite
+  mutable std::vector<sf::Vertex> vertices_;
+  mutable std::vector<Batch> batches_;
+  mutable bool dirty_ = false;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_SPRITE_LAYER_H
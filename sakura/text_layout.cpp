@@ -0,0 +1,283 @@
+#include "text_layout.h"
+#include "content_hash.h"
+#include "gpu_lock.h"
+#include "sdf_font.h"
+#include <algorithm>
+
+namespace sakura {
+
+namespace {
+
+constexpr std::size_t NONE = SIZE_MAX;
+
+// characters which may not start a line
+constexpr std::u32string_view NO_LINE_START =
+    U"!),.:;?]}¢°’”‰′″℃、。々〉》」』】〕〗〙〟ぁぃぅぇぉっゃゅょゎゕゖ"
+    U"ゝゞァィゥェォッャュョヮヵヶ・ーヽヾㇰㇱㇲㇳㇴㇵㇶㇷㇸㇹㇺㇻㇼㇽㇾㇿ"
+    U"！％），．：；？］｝｡｣､･ｧｨｩｪｫｬｭｮｯｰ～〜";
+// characters which may not end a line
+constexpr std::u32string_view NO_LINE_END =
+    U"([{£¥‘“〈《「『【〔〖〘〝＄（［｛｢￡￥";
+
+bool isSpace(char32_t c) { return c == U' ' || c == U'\t' || c == U'　'; }
+
+// scripts without spaces between words
+bool isCjk(char32_t c) {
+  return (c >= 0x2E80 && c <= 0x9FFF) || (c >= 0xAC00 && c <= 0xD7AF) ||
+         (c >= 0xF900 && c <= 0xFAFF) || (c >= 0xFE30 && c <= 0xFE4F) ||
+         (c >= 0xFF00 && c <= 0xFFEF) || (c >= 0x20000 && c <= 0x3FFFF);
+}
+
+bool canBreakBetween(char32_t before, char32_t after) {
+  if (isSpace(after)) {
+    return false;
+  }
+  if (!isSpace(before) && !isCjk(before) && !isCjk(after)) {
+    return false;
+  }
+  return NO_LINE_START.find(after) == std::u32string_view::npos &&
+         NO_LINE_END.find(before) == std::u32string_view::npos;
+}
+
+void appendQuad(std::vector<sf::Vertex> &vertices, sf::Vector2f pen,
+                const sf::Glyph &glyph) {
+  auto left = pen.x + glyph.bounds.left;
+  auto top = pen.y + glyph.bounds.top;
+  auto right = left + glyph.bounds.width;
+  auto bottom = top + glyph.bounds.height;
+  auto u0 = static_cast<float>(glyph.textureRect.left);
+  auto v0 = static_cast<float>(glyph.textureRect.top);
+  auto u1 = u0 + glyph.textureRect.width;
+  auto v1 = v0 + glyph.textureRect.height;
+  vertices.emplace_back(sf::Vector2f{left, top}, sf::Vector2f{u0, v0});
+  vertices.emplace_back(sf::Vector2f{right, top}, sf::Vector2f{u1, v0});
+  vertices.emplace_back(sf::Vector2f{left, bottom}, sf::Vector2f{u0, v1});
+  vertices.emplace_back(sf::Vector2f{left, bottom}, sf::Vector2f{u0, v1});
+  vertices.emplace_back(sf::Vector2f{right, top}, sf::Vector2f{u1, v0});
+  vertices.emplace_back(sf::Vector2f{right, bottom}, sf::Vector2f{u1, v1});
+}
+
+} // namespace
+
+void GlyphSource::prepare(const char32_t *begin, const char32_t *end) {
+  for (; begin != end; ++begin) {
+    glyph(*begin);
+  }
+}
+
+const sf::Shader *GlyphSource::shader() const { return nullptr; }
+
+// The font is only used under `gpuMutex`, the render thread may be laying
+// out texts with it.
+GlyphMetrics::GlyphMetrics(const sf::Font &font, unsigned character_size)
+    : font_(font), character_size_(character_size) {
+  std::lock_guard lock(gpuMutex());
+  line_spacing_ = font.getLineSpacing(character_size);
+}
+
+const sf::Glyph &GlyphMetrics::glyph(char32_t code_point) {
+  auto it = glyphs_.find(code_point);
+  if (it == glyphs_.end()) {
+    std::lock_guard lock(gpuMutex());
+    it = glyphs_
+             .emplace(code_point,
+                      font_.getGlyph(code_point, character_size_, false))
+             .first;
+  }
+  return it->second;
+}
+
+bool GlyphMetrics::contains(char32_t code_point) const {
+  return glyphs_.count(code_point) != 0;
+}
+
+float GlyphMetrics::kerning(char32_t first, char32_t second) {
+  if (first == 0) {
+    return 0.0f;
+  }
+  auto key = static_cast<std::uint64_t>(first) << 32 | second;
+  auto it = kerning_.find(key);
+  if (it == kerning_.end()) {
+    std::lock_guard lock(gpuMutex());
+    it = kerning_
+             .emplace(key, font_.getKerning(first, second, character_size_))
+             .first;
+  }
+  return it->second;
+}
+
+float GlyphMetrics::lineSpacing() const { return line_spacing_; }
+
+const sf::Font &GlyphMetrics::font() const { return font_; }
+
+unsigned GlyphMetrics::characterSize() const { return character_size_; }
+
+const sf::Texture &GlyphMetrics::texture() const {
+  return font_.getTexture(character_size_);
+}
+
+TextLayout layoutText(GlyphSource &glyphs, std::u32string_view text,
+                      float width) {
+  glyphs.prepare(text.data(), text.data() + text.size());
+  auto whitespace = glyphs.glyph(U' ').advance;
+  auto advanceOf = [&](char32_t c) {
+    switch (c) {
+    case U' ':
+      return whitespace;
+    case U'\t':
+      return whitespace * 4;
+    case U'\r':
+    case U'\n':
+      return 0.0f;
+    default:
+      return glyphs.glyph(c).advance;
+    }
+  };
+
+  // first pass: the index each line starts at
+  std::vector<std::size_t> line_starts{0};
+  float x = 0.0f;
+  std::size_t last_break = NONE;
+  float x_at_break = 0.0f;
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    auto c = text[i];
+    if (c == U'\n') {
+      line_starts.push_back(i + 1);
+      x = 0.0f;
+      last_break = NONE;
+      continue;
+    }
+    bool line_start = i == line_starts.back();
+    if (!line_start && canBreakBetween(text[i - 1], c)) {
+      last_break = i;
+      x_at_break = x;
+    }
+    if (!line_start) {
+      x += glyphs.kerning(text[i - 1], c);
+    }
+    x += advanceOf(c);
+    // trailing spaces may hang over the edge
+    if (width <= 0.0f || x <= width || isSpace(c) || line_start) {
+      continue;
+    }
+    if (last_break != NONE) {
+      line_starts.push_back(last_break);
+      x -= x_at_break;
+    } else {
+      // nowhere to break, break before this character
+      line_starts.push_back(i);
+      x = advanceOf(c);
+    }
+    last_break = NONE;
+  }
+
+  // second pass: the quads
+  TextLayout layout;
+  layout.lines = line_starts.size();
+  layout.vertices.reserve(text.size() * 6);
+  float min_x = 0.0f, min_y = 0.0f, max_x = 0.0f, max_y = 0.0f;
+  sf::Vector2f pen{0.0f, static_cast<float>(glyphs.characterSize())};
+  std::size_t line = 0;
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    if (line + 1 < line_starts.size() && i == line_starts[line + 1]) {
+      ++line;
+      pen = {0.0f, pen.y + glyphs.lineSpacing()};
+    }
+    auto c = text[i];
+    if (i != line_starts[line]) {
+      pen.x += glyphs.kerning(text[i - 1], c);
+    }
+    if (isSpace(c) || c == U'\r' || c == U'\n') {
+      pen.x += advanceOf(c);
+      continue;
+    }
+    const auto &glyph = glyphs.glyph(c);
+    appendQuad(layout.vertices, pen, glyph);
+    auto left = pen.x + glyph.bounds.left;
+    auto top = pen.y + glyph.bounds.top;
+    auto right = left + glyph.bounds.width;
+    auto bottom = top + glyph.bounds.height;
+    if (layout.vertices.size() == 6) {
+      min_x = left, min_y = top, max_x = right, max_y = bottom;
+    } else {
+      min_x = std::min(min_x, left);
+      min_y = std::min(min_y, top);
+      max_x = std::max(max_x, right);
+      max_y = std::max(max_y, bottom);
+    }
+    pen.x += glyph.advance;
+  }
+  layout.bounds = {min_x, min_y, max_x - min_x, max_y - min_y};
+  return layout;
+}
+
+TextLayouter::TextLayouter(std::size_t capacity) : capacity_(capacity) {}
+
+TextLayouter::~TextLayouter() = default;
+
+GlyphSource &TextLayouter::glyphs(const std::shared_ptr<const sf::Font> &font,
+                                  unsigned character_size) {
+  auto key = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(
+                 font.get())) ^
+             static_cast<std::uint64_t>(character_size) << 48;
+  auto it = glyphs_.find(key);
+  if (it != glyphs_.end()) {
+    return *it->second.glyphs;
+  }
+
+  std::unique_ptr<GlyphSource> glyphs;
+  SdfFont *sdf_font = nullptr;
+  if (sdf) {
+    auto &entry = sdf_fonts_[font.get()];
+    if (entry == nullptr) {
+      if (auto bytes = sdf(*font)) {
+        entry = std::make_unique<SdfFont>(std::move(bytes));
+      }
+    }
+    sdf_font = entry.get();
+  }
+  if (sdf_font != nullptr) {
+    glyphs = std::make_unique<SdfGlyphs>(*sdf_font, character_size);
+  } else {
+    glyphs = std::make_unique<GlyphMetrics>(*font, character_size);
+  }
+  return *glyphs_.emplace(key, FontGlyphs{font, std::move(glyphs)})
+              .first->second.glyphs;
+}
+
+std::shared_ptr<const TextLayout>
+TextLayouter::layout(const std::shared_ptr<const sf::Font> &font,
+                     unsigned character_size, std::u32string_view text,
+                     float width) {
+  ContentHasher hasher(character_size);
+  hasher.update(text.data(), text.size() * sizeof(char32_t));
+  auto address = reinterpret_cast<std::uintptr_t>(font.get());
+  hasher.update(&address, sizeof(address));
+  hasher.update(&width, sizeof(width));
+  auto key = hasher.digest();
+
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    auto &entry = *it->second;
+    if (entry.text == text && entry.font == font.get() &&
+        entry.character_size == character_size && entry.width == width) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return entry.layout;
+    }
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+
+  auto layout = std::make_shared<const TextLayout>(layoutText(
+      glyphs(font, character_size), text, width));
+  entries_.push_front(Entry{key, std::u32string{text}, font.get(),
+                            character_size, width, layout});
+  index_[key] = entries_.begin();
+  if (entries_.size() > capacity_) {
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+  }
+  return layout;
+}
+
+} // namespace sakura
@@ -0,0 +1,126 @@
+#ifndef SAKURA_TEXT_LAYOUT_H
+#define SAKURA_TEXT_LAYOUT_H
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sakura {
+
+class SdfFont;
+
+// Glyphs of one font at one size, and the texture and shader to draw them
+// with.
+class GlyphSource {
+public:
+  virtual ~GlyphSource() = default;
+
+  // `textureRect` is in `texture()`
+  virtual const sf::Glyph &glyph(char32_t code_point) = 0;
+  virtual bool contains(char32_t code_point) const = 0;
+  // Makes the glyphs ready at once, which may be cheaper than one by one.
+  virtual void prepare(const char32_t *begin, const char32_t *end);
+  virtual float kerning(char32_t first, char32_t second) = 0;
+  virtual float lineSpacing() const = 0;
+  virtual unsigned characterSize() const = 0;
+  virtual const sf::Texture &texture() const = 0;
+  virtual const sf::Shader *shader() const;
+};
+
+// Glyphs and kerning of one font at one size, each looked up from the font
+// once.
+class GlyphMetrics : public GlyphSource {
+public:
+  GlyphMetrics(const sf::Font &font, unsigned character_size);
+
+  const sf::Glyph &glyph(char32_t code_point) override;
+  bool contains(char32_t code_point) const override;
+  float kerning(char32_t first, char32_t second) override;
+  float lineSpacing() const override;
+  unsigned characterSize() const override;
+  const sf::Texture &texture() const override;
+
+  const sf::Font &font() const;
+
+private:
+  const sf::Font &font_;
+  unsigned character_size_;
+  float line_spacing_;
+  std::unordered_map<char32_t, sf::Glyph> glyphs_;
+  std::unordered_map<std::uint64_t, float> kerning_;
+};
+
+struct TextLayout {
+  // two triangles per visible glyph, in reading order
+  std::vector<sf::Vertex> vertices;
+  sf::FloatRect bounds;
+  std::size_t lines = 0;
+};
+
+// Breaks lines greedily so that they fit `width`, 0 for no wrapping. Latin
+// text breaks after spaces, CJK text between any two characters except
+// where kinsoku shori forbids it. A word longer than a line is broken
+// anywhere. O(n) in the length of `text`. The glyphs missing from `glyphs`
+// are prepared together first.
+TextLayout layoutText(GlyphSource &glyphs, std::u32string_view text,
+                      float width);
+
+// Layouts of recently shown lines by their text, so that showing a line again
+// doesn't lay it out again.
+class TextLayouter {
+public:
+  explicit TextLayouter(std::size_t capacity = 256);
+  ~TextLayouter();
+
+  std::shared_ptr<const TextLayout>
+  layout(const std::shared_ptr<const sf::Font> &font, unsigned character_size,
+         std::u32string_view text, float width);
+  // Signed distance field glyphs if `sdf` is set, bitmap glyphs otherwise.
+  GlyphSource &glyphs(const std::shared_ptr<const sf::Font> &font,
+                      unsigned character_size);
+
+public:
+  // If set, every size is drawn from one distance field atlas per font,
+  // instead of rasterizing each size. It returns the bytes of the file the
+  // font was loaded from, which the atlas rasterizes glyphs from, or null to
+  // keep bitmap glyphs for that font. Only set it if `SdfFont::shader` is
+  // available.
+  std::function<std::shared_ptr<const std::vector<char>>(const sf::Font &)>
+      sdf;
+
+private:
+  struct Entry {
+    std::uint64_t key;
+    std::u32string text;
+    const sf::Font *font;
+    unsigned character_size;
+    float width;
+    std::shared_ptr<const TextLayout> layout;
+  };
+
+  struct FontGlyphs {
+    // keeps the font alive, so that its address is not reused by another
+    std::shared_ptr<const sf::Font> font;
+    std::unique_ptr<GlyphSource> glyphs;
+  };
+
+private:
+  std::size_t capacity_;
+  // most recently used first
+  std::list<Entry> entries_;
+  std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index_;
+  std::unordered_map<std::uint64_t, FontGlyphs> glyphs_;
+  // by font
+  std::unordered_map<const sf::Font *, std::unique_ptr<SdfFont>> sdf_fonts_;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_TEXT_LAYOUT_H
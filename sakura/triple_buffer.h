@@ -0,0 +1,48 @@
+#ifndef SAKURA_TRIPLE_BUFFER_H
+#define SAKURA_TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+
+namespace sakura {
+
+// Hands the latest value from one producer thread to one consumer thread
+// without locks. The producer fills `back` and publishes it, the consumer
+// acquires the most recently published value into `front`. Neither ever
+// waits, values published in between are dropped.
+template <typename T> class TripleBuffer {
+public:
+  // Producer side. The slot keeps what it held before, reuse its storage.
+  T &back() { return slots_[back_]; }
+
+  void publish() {
+    auto previous = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+    back_ = previous & INDEX;
+  }
+
+  // Consumer side. Returns whether `front` is a newly published value.
+  bool acquire() {
+    if ((middle_.load(std::memory_order_relaxed) & FRESH) == 0) {
+      return false;
+    }
+    auto previous = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = previous & INDEX;
+    return true;
+  }
+
+  const T &front() const { return slots_[front_]; }
+
+private:
+  static constexpr unsigned INDEX = 3;
+  static constexpr unsigned FRESH = 4;
+
+  std::array<T, 3> slots_;
+  unsigned back_ = 0;
+  unsigned front_ = 1;
+  // the index of the middle slot, with FRESH if not acquired yet
+  std::atomic<unsigned> middle_{2};
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_TRIPLE_BUFFER_H
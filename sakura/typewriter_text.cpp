@@ -0,0 +1,102 @@
+#include "typewriter_text.h"
+#include <algorithm>
+#include <cmath>
+
+namespace sakura {
+
+void TypewriterText::setCharacterSize(unsigned size) { character_size_ = size; }
+
+unsigned TypewriterText::getCharacterSize() const { return character_size_; }
+
+void TypewriterText::setLayout(const TextLayout &layout,
+                               const GlyphSource &glyphs) {
+  glyphs_ = &glyphs;
+  vertices_ = layout.vertices;
+  bounds_ = layout.bounds;
+  progress_ = 0.0f;
+  if (speed <= 0.0f) {
+    complete();
+    return;
+  }
+  for (auto &vertex : vertices_) {
+    vertex.color.a = 0;
+  }
+}
+
+void TypewriterText::setAlpha(std::size_t glyph, sf::Uint8 alpha) {
+  for (std::size_t i = glyph * 6; i < glyph * 6 + 6; ++i) {
+    vertices_[i].color.a = alpha;
+  }
+}
+
+void TypewriterText::update(sf::Time elapsed) {
+  if (finished()) {
+    return;
+  }
+  auto count = glyphCount();
+  auto fade_width = std::max(fade, 0.0f);
+  auto previous = progress_;
+  progress_ = std::min(progress_ + speed * elapsed.asSeconds(),
+                       static_cast<float>(count) + fade_width);
+
+  // only the glyphs whose alpha changed since the last frame
+  auto first = static_cast<std::size_t>(
+      std::max(0.0f, std::floor(previous - fade_width)));
+  auto last =
+      std::min(count, static_cast<std::size_t>(std::ceil(progress_)));
+  for (auto i = first; i < last; ++i) {
+    auto shown = progress_ - static_cast<float>(i);
+    auto alpha = fade_width > 0.0f ? std::clamp(shown / fade_width, 0.0f, 1.0f)
+                                   : (shown > 0.0f ? 1.0f : 0.0f);
+    setAlpha(i, static_cast<sf::Uint8>(alpha * 255.0f));
+  }
+}
+
+void TypewriterText::complete() {
+  for (auto &vertex : vertices_) {
+    vertex.color.a = 255;
+  }
+  progress_ = static_cast<float>(glyphCount()) + std::max(fade, 0.0f);
+}
+
+bool TypewriterText::finished() const {
+  return progress_ >= static_cast<float>(glyphCount()) + std::max(fade, 0.0f);
+}
+
+sf::FloatRect TypewriterText::getLocalBounds() const { return bounds_; }
+
+sf::FloatRect TypewriterText::getGlobalBounds() const {
+  return getTransform().transformRect(bounds_);
+}
+
+std::size_t TypewriterText::glyphCount() const { return vertices_.size() / 6; }
+
+void TypewriterText::record(DrawList &list, sf::RenderStates states) const {
+  if (glyphs_ == nullptr) {
+    return;
+  }
+  auto shown = std::min(glyphCount(),
+                        static_cast<std::size_t>(std::ceil(progress_)));
+  states.transform *= getTransform();
+  states.texture = &glyphs_->texture();
+  states.shader = glyphs_->shader();
+  list.add(vertices_.data(), shown * 6, states);
+}
+
+void TypewriterText::draw(sf::RenderTarget &target,
+                          sf::RenderStates states) const {
+  if (glyphs_ == nullptr || vertices_.empty()) {
+    return;
+  }
+  auto shown = std::min(glyphCount(),
+                        static_cast<std::size_t>(std::ceil(progress_)));
+  if (shown == 0) {
+    return;
+  }
+  states.transform *= getTransform();
+  states.texture = &glyphs_->texture();
+  states.shader = glyphs_->shader();
+  target.draw(vertices_.data(), shown * 6, sf::Triangles, states);
+}
+
+} // namespace sakura
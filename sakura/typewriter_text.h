@@ -0,0 +1,58 @@
+#ifndef SAKURA_TYPEWRITER_TEXT_H
+#define SAKURA_TYPEWRITER_TEXT_H
+
+#include "draw_list.h"
+#include "text_layout.h"
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace sakura {
+
+// Text revealed glyph by glyph. The text is laid out once, every frame only
+// the glyphs fading in are touched, whatever the length.
+class TypewriterText : public sf::Drawable, public sf::Transformable {
+public:
+  // The size layouts are made with.
+  void setCharacterSize(unsigned size);
+  unsigned getCharacterSize() const;
+  // Starts revealing `layout` from the first glyph. `glyphs` is what it has
+  // been made with, and must outlive this text.
+  void setLayout(const TextLayout &layout, const GlyphSource &glyphs);
+
+  void update(sf::Time elapsed);
+  // Shows the whole string at once.
+  void complete();
+  bool finished() const;
+
+  sf::FloatRect getLocalBounds() const;
+  sf::FloatRect getGlobalBounds() const;
+  std::size_t glyphCount() const;
+  // Appends the glyphs shown so far to `list`.
+  void record(DrawList &list, sf::RenderStates states) const;
+
+public:
+  // glyphs per second, 0 shows the whole string at once
+  float speed = 40.0f;
+  // glyphs fading in at the same time
+  float fade = 4.0f;
+
+protected:
+  void draw(sf::RenderTarget &target, sf::RenderStates states) const override;
+
+private:
+  void setAlpha(std::size_t glyph, sf::Uint8 alpha);
+
+private:
+  const GlyphSource *glyphs_ = nullptr;
+  unsigned character_size_ = 30;
+  // two triangles per glyph
+  std::vector<sf::Vertex> vertices_;
+  sf::FloatRect bounds_;
+  // glyphs revealed so far, the fractional part is fading in
+  float progress_ = 0.0f;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_TYPEWRITER_TEXT_H
@@ -0,0 +1,104 @@
+#include "utf8.h"
+#include <fmt/core.h>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SAKURA_HAS_SSE2
+#endif
+
+namespace sakura {
+
+namespace {
+
+// Widens the ASCII prefix of `src`, returns its length. Only whole blocks
+// of 16 bytes are done here, the caller decodes the rest byte by byte.
+std::size_t widenAscii(const std::uint8_t *src, std::size_t size,
+                       char32_t *dst) {
+  std::size_t i = 0;
+#ifdef SAKURA_HAS_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= size; i += 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    if (_mm_movemask_epi8(bytes) != 0) {
+      break;
+    }
+    __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+    __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+    auto *out = reinterpret_cast<__m128i *>(dst + i);
+    _mm_storeu_si128(out, _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, zero));
+  }
+#endif
+  return i;
+}
+
+[[noreturn]] void invalid(std::size_t offset) {
+  throw std::runtime_error(fmt::format("invalid UTF-8 at byte {}", offset));
+}
+
+} // namespace
+
+std::u32string decodeUtf8(std::string_view text) {
+  // never more code points than bytes
+  std::u32string result(text.size(), U'\0');
+  const auto *src = reinterpret_cast<const std::uint8_t *>(text.data());
+  auto size = text.size();
+  auto *dst = result.data();
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < size) {
+    auto ascii = widenAscii(src + i, size - i, dst + j);
+    i += ascii;
+    j += ascii;
+    if (i == size) {
+      break;
+    }
+
+    auto lead = src[i];
+    if (lead < 0x80) {
+      dst[j++] = lead;
+      ++i;
+      continue;
+    }
+    std::size_t length;
+    char32_t code_point;
+    char32_t min;
+    if ((lead & 0xE0) == 0xC0) {
+      length = 2, code_point = lead & 0x1F, min = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+      length = 3, code_point = lead & 0x0F, min = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+      length = 4, code_point = lead & 0x07, min = 0x10000;
+    } else {
+      invalid(i);
+    }
+    if (length > size - i) {
+      invalid(i);
+    }
+    for (std::size_t k = 1; k < length; ++k) {
+      auto byte = src[i + k];
+      if ((byte & 0xC0) != 0x80) {
+        invalid(i);
+      }
+      code_point = code_point << 6 | (byte & 0x3F);
+    }
+    if (code_point < min || code_point > 0x10FFFF ||
+        (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+      invalid(i);
+    }
+    dst[j++] = code_point;
+    i += length;
+  }
+  result.resize(j);
+  return result;
+}
+
+sf::String toSfString(std::u32string_view text) {
+  return sf::String::fromUtf32(text.begin(), text.end());
+}
+
+} // namespace sakura
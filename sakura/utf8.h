@@ -0,0 +1,21 @@
+#ifndef SAKURA_UTF8_H
+#define SAKURA_UTF8_H
+
+#include <SFML/System.hpp>
+#include <string>
+#include <string_view>
+
+namespace sakura {
+
+// Decodes UTF-8, rejecting overlong forms, surrogates, code points above
+// U+10FFFF and truncated sequences. Runs of ASCII are widened 16 bytes at a
+// time. Throws `std::runtime_error` with the offset of the first invalid
+// byte.
+std::u32string decodeUtf8(std::string_view text);
+
+// Copies code points into an sf::String, nothing is decoded.
+sf::String toSfString(std::u32string_view text);
+
+} // namespace sakura
+
+#endif // !SAKURA_UTF8_H
@@ -1,13 +1,14 @@
 #include "utility.h"
-#include <codecvt>
-#include <locale>
+#include <algorithm>
 
-namespace sakura {
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
 
-std::wstring utf8ToWstring(const std::string &str) {
-  std::wstring_convert<std::codecvt_utf8<wchar_t>> wc;
-  return wc.from_bytes(str);
-}
+namespace sakura {
 
 std::string concat_if_relative(const std::filesystem::path &prefix,
                                const std::string &path) {
@@ -15,4 +16,35 @@ std::string concat_if_relative(const std::filesystem::path &prefix,
                                                    : path;
 }
 
+sf::FloatRect unite(const sf::FloatRect &lhs, const sf::FloatRect &rhs) {
+  if (lhs.width <= 0 || lhs.height <= 0) {
+    return rhs;
+  }
+  if (rhs.width <= 0 || rhs.height <= 0) {
+    return lhs;
+  }
+  auto left = std::min(lhs.left, rhs.left);
+  auto top = std::min(lhs.top, rhs.top);
+  auto right = std::max(lhs.left + lhs.width, rhs.left + rhs.width);
+  auto bottom = std::max(lhs.top + lhs.height, rhs.top + rhs.height);
+  return {left, top, right - left, bottom - top};
+}
+
+std::size_t peakResidentBytes() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+  GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+  return counters.PeakWorkingSetSize;
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+  // in KiB
+  return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
 } // namespace sakura
@@ -1,17 +1,23 @@
 #ifndef SAKURA_UTILITY_H
 #define SAKURA_UTILITY_H
 
+#include <SFML/Graphics.hpp>
+#include <cstddef>
 #include <filesystem>
 #include <nlohmann/json.hpp>
 #include <string>
 
 namespace sakura {
 
-std::wstring utf8ToWstring(const std::string &str);
-
 std::string concat_if_relative(const std::filesystem::path &prefix,
                                const std::string &path);
 
+// The smallest rectangle containing both, an empty one is ignored.
+sf::FloatRect unite(const sf::FloatRect &lhs, const sf::FloatRect &rhs);
+
+// The peak resident set size of the process so far.
+std::size_t peakResidentBytes();
+
 template <nlohmann::json::value_t Ty>
 bool exists(const nlohmann::json &j, const std::string &key) {
   auto it = j.find(key);
@@ -1,40 +1,23 @@
 #ifndef SAKURA_WIDGET_H
 #define SAKURA_WIDGET_H
 
+#include "typewriter_text.h"
 #include <SFML/Graphics.hpp>
-#include <memory>
-#include <string>
-#include <unordered_map>
-#include <vector>
+#include <string_view>
 
 namespace sakura {
 
-struct Widget {
-  virtual ~Widget() = default;
-  virtual void render(sf::RenderTarget &render_target) const = 0;
-  virtual std::string on(const sf::Event &event) const = 0;
-};
-
-struct PushButton : public Widget {
-  void render(sf::RenderTarget &render_target) const override;
-  std::string on(const sf::Event &event) const override;
-  void setText(const std::string &text);
-
-  sf::RectangleShape shape;
-  sf::Text text;
-  std::unordered_map<std::string, std::string> actions;
-};
-
-struct Dialog : public Widget {
-  void render(sf::RenderTarget &render_target) const override;
-  std::string on(const sf::Event &event) const override;
-  void setText(const std::string &text);
-  void setName(const std::string &name);
+// The text part of the main dialog of a scene, its frame and buttons are in
+// the `WidgetStore` of the scene.
+struct Dialog {
+  void setText(const TextLayout &layout, const GlyphSource &glyphs);
+  // the width the text wraps at, keeping the left margin on the right too
+  float textWidth() const;
+  void setName(std::u32string_view name);
 
-  sf::RectangleShape shape;
-  sf::Text text;
+  sf::FloatRect frame;
+  TypewriterText text;
   sf::Text name;
-  std::vector<std::unique_ptr<Widget>> children;
 };
 
 } // namespace sakura
@@ -1,151 +1,62 @@
 #include "widget_factory.h"
-#include "utility.h"
-#include <fmt/core.h>
-#include <stdexcept>
+#include "utf8.h"
 
 namespace sakura {
 
-WidgetFactory::WidgetFactory(ResourceManager &resources)
-    : resources_(resources) {}
-
-// PushButton:
-// {
-//   "class": "push_button",
-//   "shape": {
-//     "left": number,
-//     "top": number,
-//     "width": number,
-//     "height": number,
-//     "texture": <optional> string
-//   },
-//   "text": <optional> string,
-//   "actions": {
-//     <optional> "clicked": string
-//   }
-// }
-
-// Dialog:
-// {
-//   "class": "dialog",
-//   "shape": {
-//     "left": number,
-//     "right": number,
-//     "width": number,
-//     "height": number,
-//     "texture": <optional> string
-//   },
-//   "text": {
-//     "left": number,
-//     "top": number
-//   },
-//   "name": {
-//     "left": number,
-//     "top": number
-//   },
-//   "children": [
-//     <optional>
-//   ]
-// }
-
-std::unique_ptr<Widget>
-WidgetFactory::from(const nlohmann::json &config,
-                    const nlohmann::json &global) const {
-  std::string type;
-  if (exists<nlohmann::json::value_t::string>(config, "class")) {
-    type = config["class"].get<std::string>();
-  } else {
-    throw std::runtime_error("empty widget class name");
-  }
-  if (type == "push_button") {
-    return createPushButton(config, global);
-  } else if (type == "dialog") {
-    return createDialog(config, global);
-  } else {
-    throw std::runtime_error(fmt::format("{}: invalid widget type", type));
-  }
+WidgetFactory::WidgetFactory(
+    const SceneProto &proto,
+    const std::vector<std::shared_ptr<sf::Texture>> &textures,
+    const sf::Font &font)
+    : proto_(proto), textures_(textures), font_(font) {}
+
+std::uint32_t WidgetFactory::add(WidgetStore &store,
+                                 std::uint32_t index) const {
+  const auto &config = proto_.widgets[index];
+  const sf::Texture *texture = nullptr;
+  if (config.texture != SceneProto::NONE) {
+    texture = textures_[config.texture].get();
+  }
+  auto widget = store.addFrame(config.shape, texture);
+
+  switch (config.type) {
+  case WidgetProto::PUSH_BUTTON: {
+    sf::Text label;
+    setUpText(label);
+    auto button = store.addButton(widget, std::move(label), config.actions);
+    if (!config.text.empty()) {
+      store.setLabel(button, decodeUtf8(config.text));
+    }
+    break;
+  }
+  case WidgetProto::DIALOG:
+    for (std::uint32_t i = 0; i < config.child_count; ++i) {
+      add(store, config.first_child + i);
+    }
+    break;
+  }
+  return widget;
 }
 
-std::unique_ptr<Widget>
-WidgetFactory::createPushButton(const nlohmann::json &config,
-                                const nlohmann::json &global) const {
-  auto button = new PushButton;
-
-  if (!exists<nlohmann::json::value_t::object>(config, "shape")) {
-    throw std::runtime_error(
-        "<Anonymous PushButton>: expects shape configuration");
-  }
-  auto shape = config["shape"];
-
-  // TODO: check "left", "top" and so on
-  button->shape.setPosition(
-      {shape["left"].get<float>(), shape["top"].get<float>()});
-  button->shape.setSize(
-      {shape["width"].get<float>(), shape["height"].get<float>()});
-  if (exists<nlohmann::json::value_t::string>(shape, "texture")) {
-    button->shape.setTexture(
-        resources_.loadTexture(shape["texture"].get<std::string>()).get());
-  }
+std::unique_ptr<Dialog> WidgetFactory::createDialog(std::uint32_t index) const {
+  const auto &config = proto_.widgets[index];
+  auto dialog = std::make_unique<Dialog>();
 
-  button->text.setFont(
-      *resources_.loadFont(global["font_face"].get<std::string>()));
-  button->text.setCharacterSize(global["font_size"].get<int>());
-  if (exists<nlohmann::json::value_t::string>(config, "text")) {
-    button->setText(config["text"].get<std::string>());
-  }
-
-  for (auto &action : config["actions"].items()) {
-    button->actions[action.key()] = action.value();
-  }
+  dialog->frame = config.shape;
+  setUpText(dialog->text);
+  dialog->text.setPosition(config.text_position);
+  setUpText(dialog->name);
+  dialog->name.setPosition(config.name_position);
 
-  return std::unique_ptr<Widget>{button};
+  return dialog;
 }
 
-std::unique_ptr<Widget>
-WidgetFactory::createDialog(const nlohmann::json &config,
-                            const nlohmann::json &global) const {
-  auto dialog = new Dialog;
-
-  if (!exists<nlohmann::json::value_t::object>(config, "shape")) {
-    throw std::runtime_error("<Anonymous Dialog>: expects shape configuration");
-  }
-  if (!exists<nlohmann::json::value_t::object>(config, "text")) {
-    throw std::runtime_error("<Anonymous Dialog>: expects text configuration");
-  }
-  if (!exists<nlohmann::json::value_t::object>(config, "name")) {
-    throw std::runtime_error("<Anonymous Dialog>: expects name configuration");
-  }
-
-  auto shape = config["shape"];
-  auto text = config["text"];
-  auto name = config["name"];
-
-  // TODO: check "left", "top" and so on
-  dialog->shape.setPosition(
-      {shape["left"].get<float>(), shape["top"].get<float>()});
-  dialog->shape.setSize(
-      {shape["width"].get<float>(), shape["height"].get<float>()});
-  if (exists<nlohmann::json::value_t::string>(shape, "texture")) {
-    dialog->shape.setTexture(
-        resources_.loadTexture(shape["texture"].get<std::string>()).get());
-  }
-
-  dialog->text.setPosition(
-      {text["left"].get<float>(), text["top"].get<float>()});
-  dialog->text.setFont(
-      *resources_.loadFont(global["font_face"].get<std::string>()));
-  dialog->text.setCharacterSize(global["font_size"].get<int>());
-
-  dialog->name.setPosition(
-      {name["left"].get<float>(), name["top"].get<float>()});
-  dialog->name.setFont(
-      *resources_.loadFont(global["font_face"].get<std::string>()));
-  dialog->name.setCharacterSize(global["font_size"].get<int>());
-
-  for (auto &child : config["children"]) {
-    dialog->children.push_back(from(child, global));
-  }
+void WidgetFactory::setUpText(sf::Text &text) const {
+  text.setFont(font_);
+  text.setCharacterSize(proto_.font_size);
+}
 
-  return std::unique_ptr<Widget>{dialog};
+void WidgetFactory::setUpText(TypewriterText &text) const {
+  text.setCharacterSize(proto_.font_size);
 }
 
 } // namespace sakura
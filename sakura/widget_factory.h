@@ -1,25 +1,35 @@
 #ifndef SAKURA_WIDGET_FACTORY_H
 #define SAKURA_WIDGET_FACTORY_H
 
-#include "resource_manager.h"
+#include "scene_proto.h"
 #include "widget.h"
+#include "widget_store.h"
+#include <SFML/Graphics.hpp>
+#include <cstdint>
 #include <memory>
-#include <nlohmann/json.hpp>
+#include <vector>
 
 namespace sakura {
 
 class WidgetFactory {
 public:
-  explicit WidgetFactory(ResourceManager &resources);
-  std::unique_ptr<Widget> from(const nlohmann::json &config,
-                               const nlohmann::json &global) const;
+  WidgetFactory(const SceneProto &proto,
+                const std::vector<std::shared_ptr<sf::Texture>> &textures,
+                const sf::Font &font);
+  // Adds the widget `index` of the prototype and its descendants to
+  // `store`, returns the index of the widget in `store`.
+  std::uint32_t add(WidgetStore &store, std::uint32_t index) const;
+  // The text part of the dialog `index`.
+  std::unique_ptr<Dialog> createDialog(std::uint32_t index) const;
 
 private:
-  std::unique_ptr<Widget> createPushButton(const nlohmann::json &config, const nlohmann::json &global) const;
-  std::unique_ptr<Widget> createDialog(const nlohmann::json &config, const nlohmann::json &global) const;
+  void setUpText(sf::Text &text) const;
+  void setUpText(TypewriterText &text) const;
 
 private:
-  ResourceManager &resources_;
+  const SceneProto &proto_;
+  const std::vector<std::shared_ptr<sf::Texture>> &textures_;
+  const sf::Font &font_;
 };
 
 } // namespace sakura
@@ -0,0 +1,164 @@
+#include "widget_store.h"
+#include "cooked_texture.h"
+#include "gpu_lock.h"
+#include "utf8.h"
+#include "utility.h"
+
+namespace sakura {
+
+namespace {
+
+// multiplies the texture, which keeps its premultiplied alpha valid
+sf::Color tint(WidgetStore::State state) {
+  switch (state) {
+  case WidgetStore::HOVERED:
+    return {224, 224, 224};
+  case WidgetStore::PRESSED:
+    return {192, 192, 192};
+  default:
+    return sf::Color::White;
+  }
+}
+
+} // namespace
+
+std::uint32_t WidgetStore::addFrame(const sf::FloatRect &rect,
+                                    const sf::Texture *texture) {
+  rects.push_back(rect);
+  textures.push_back(texture);
+  buttons.push_back(NONE);
+  dirty_ = true;
+  return static_cast<std::uint32_t>(rects.size() - 1);
+}
+
+std::uint32_t WidgetStore::addButton(std::uint32_t widget, sf::Text label,
+                                     Actions actions) {
+  auto button = static_cast<std::uint32_t>(widgets.size());
+  buttons[widget] = button;
+  widgets.push_back(widget);
+  labels.push_back(std::move(label));
+  this->actions.push_back(std::move(actions));
+  states.push_back(NORMAL);
+  return button;
+}
+
+std::uint32_t WidgetStore::size() const {
+  return static_cast<std::uint32_t>(rects.size());
+}
+
+std::uint32_t WidgetStore::buttonCount() const {
+  return static_cast<std::uint32_t>(widgets.size());
+}
+
+void WidgetStore::rebuild() const {
+  vertices_.clear();
+  vertices_.reserve(rects.size() * 6);
+  for (std::uint32_t i = 0; i < rects.size(); ++i) {
+    auto &rect = rects[i];
+    sf::Vector2f size;
+    if (textures[i] != nullptr) {
+      size = static_cast<sf::Vector2f>(textures[i]->getSize());
+    }
+    auto color = buttons[i] == NONE ? sf::Color::White
+                                    : tint(states[buttons[i]]);
+    sf::Vector2f tl{rect.left, rect.top};
+    sf::Vector2f tr{rect.left + rect.width, rect.top};
+    sf::Vector2f bl{rect.left, rect.top + rect.height};
+    sf::Vector2f br{rect.left + rect.width, rect.top + rect.height};
+    vertices_.emplace_back(tl, color, sf::Vector2f{0, 0});
+    vertices_.emplace_back(tr, color, sf::Vector2f{size.x, 0});
+    vertices_.emplace_back(bl, color, sf::Vector2f{0, size.y});
+    vertices_.emplace_back(bl, color, sf::Vector2f{0, size.y});
+    vertices_.emplace_back(tr, color, sf::Vector2f{size.x, 0});
+    vertices_.emplace_back(br, color, size);
+  }
+  dirty_ = false;
+}
+
+void WidgetStore::record(DrawList &list, std::uint32_t begin,
+                         std::uint32_t end) const {
+  if (dirty_) {
+    rebuild();
+  }
+  // the list merges consecutive frames with the same texture, up to the
+  // next label, which later frames may cover
+  sf::RenderStates states(BlendPremultipliedAlpha);
+  for (auto i = begin; i < end; ++i) {
+    states.texture = textures[i];
+    list.add(vertices_.data() + std::size_t{i} * 6, 6, states);
+    if (buttons[i] != NONE) {
+      list.addText(labels[buttons[i]]);
+    }
+  }
+}
+
+void WidgetStore::render(sf::RenderTarget &target, std::uint32_t begin,
+                         std::uint32_t end) const {
+  DrawList list;
+  record(list, begin, end);
+  list.draw(target);
+}
+
+sf::FloatRect WidgetStore::bounds(std::uint32_t begin,
+                                  std::uint32_t end) const {
+  sf::FloatRect rect;
+  for (auto i = begin; i < end; ++i) {
+    rect = unite(rect, rects[i]);
+    if (buttons[i] != NONE) {
+      rect = unite(rect, labels[buttons[i]].getGlobalBounds());
+    }
+  }
+  return rect;
+}
+
+void WidgetStore::index(std::uint32_t begin, std::uint32_t end) {
+  indexed_.clear();
+  std::vector<sf::FloatRect> rects;
+  for (auto i = begin; i < end; ++i) {
+    if (buttons[i] != NONE) {
+      indexed_.push_back(buttons[i]);
+      rects.push_back(this->rects[i]);
+    }
+  }
+  hit_grid_.build(std::move(rects));
+}
+
+std::uint32_t WidgetStore::buttonAt(sf::Vector2f point) const {
+  auto i = hit_grid_.find(point);
+  return i == HitGrid::NONE ? NONE : indexed_[i];
+}
+
+bool WidgetStore::contains(std::uint32_t button, sf::Vector2f point) const {
+  return rects[widgets[button]].contains(point);
+}
+
+void WidgetStore::setLabel(std::uint32_t button, std::u32string_view text) {
+  auto &label = labels[button];
+  label.setString(toSfString(text));
+  sf::FloatRect text_size;
+  {
+    // lays the label out, which may rasterize glyphs
+    std::lock_guard lock(gpuMutex());
+    text_size = label.getGlobalBounds();
+  }
+  auto &rect = rects[widgets[button]];
+  label.setPosition(rect.left + (rect.width - text_size.width) / 2,
+                    rect.top + (rect.height - text_size.height) / 2);
+}
+
+bool WidgetStore::setState(std::uint32_t button, State state) {
+  if (states[button] == state) {
+    return false;
+  }
+  states[button] = state;
+  if (!dirty_) {
+    auto color = tint(state);
+    auto first = std::size_t{widgets[button]} * 6;
+    for (auto i = first; i < first + 6; ++i) {
+      vertices_[i].color = color;
+    }
+  }
+  return true;
+}
+
+} // namespace sakura
@@ -0,0 +1,82 @@
+#ifndef SAKURA_WIDGET_STORE_H
+#define SAKURA_WIDGET_STORE_H
+
+#include "draw_list.h"
+#include "hit_grid.h"
+#include "scene_proto.h"
+#include <SFML/Graphics.hpp>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sakura {
+
+// The widgets of a scene in flat arrays, in drawing order with every parent
+// before its children. Each widget is a frame, a rectangle which may be
+// textured, and a button also has a label and actions. Consecutive frames
+// with the same texture are drawn in one call, which ends at a frame with a
+// label, so that the label is drawn above it and below the widgets after it.
+class WidgetStore {
+public:
+  static constexpr std::uint32_t NONE = UINT32_MAX;
+
+  enum State : std::uint8_t { NORMAL, HOVERED, PRESSED };
+  using Actions = std::array<std::string, WidgetProto::EVENT_COUNT>;
+
+  // Returns the index of the widget.
+  std::uint32_t addFrame(const sf::FloatRect &rect,
+                         const sf::Texture *texture);
+  // Makes the widget a button, returns the index of the button.
+  std::uint32_t addButton(std::uint32_t widget, sf::Text label,
+                          Actions actions);
+  std::uint32_t size() const;
+  std::uint32_t buttonCount() const;
+
+  // Appends the widgets in [begin, end) to `list`.
+  void record(DrawList &list, std::uint32_t begin, std::uint32_t end) const;
+  void render(sf::RenderTarget &target, std::uint32_t begin,
+              std::uint32_t end) const;
+  // covers everything `render` draws of the range
+  sf::FloatRect bounds(std::uint32_t begin, std::uint32_t end) const;
+
+  // Indexes the buttons of the widgets in [begin, end) for `buttonAt`.
+  void index(std::uint32_t begin, std::uint32_t end);
+  // The topmost indexed button under `point`, or NONE.
+  std::uint32_t buttonAt(sf::Vector2f point) const;
+  bool contains(std::uint32_t button, sf::Vector2f point) const;
+
+  // Centers `text` in the button.
+  void setLabel(std::uint32_t button, std::u32string_view text);
+  // Tints the button, returns whether the state changed.
+  bool setState(std::uint32_t button, State state);
+
+public:
+  // by widget
+  std::vector<sf::FloatRect> rects;
+  std::vector<const sf::Texture *> textures;
+  // NONE if the widget is not a button
+  std::vector<std::uint32_t> buttons;
+
+  // by button
+  std::vector<std::uint32_t> widgets;
+  std::vector<sf::Text> labels;
+  std::vector<Actions> actions;
+  std::vector<State> states;
+
+private:
+  void rebuild() const;
+
+private:
+  // the indexed buttons, by their index in `hit_grid_`
+  std::vector<std::uint32_t> indexed_;
+  HitGrid hit_grid_;
+  // two triangles per frame, in widget order
+  mutable std::vector<sf::Vertex> vertices_;
+  mutable bool dirty_ = true;
+};
+
+} // namespace sakura
+
+#endif // !SAKURA_WIDGET_STORE_H
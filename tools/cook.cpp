@@ -0,0 +1,316 @@
+// sakura-cook: converts the textures of a project into pre-decoded RGBA files
+// with premultiplied alpha, so that the engine uploads them without decoding,
+// and compiles the scene config files into binary scene prototypes. The
+// content hashes of textures and fonts are recorded in manifest.json, which
+// lets the engine share one copy of identical files.
+//
+// Usage: sakura-cook [-j <jobs>] [--force] <project dir>
+
+#include "../sakura/content_hash.h"
+#include "../sakura/cooked_texture.h"
+#include "../sakura/scene_proto.h"
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+template <std::size_t N>
+bool hasExtension(const std::filesystem::path &path,
+                  const char *const (&extensions)[N]) {
+  auto ext = path.extension().string();
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return std::find(std::begin(extensions), std::end(extensions), ext) !=
+         std::end(extensions);
+}
+
+bool isImage(const std::filesystem::path &path) {
+  static const char *const extensions[] = {".png", ".jpg", ".jpeg", ".bmp",
+                                           ".tga", ".gif", ".psd",  ".hdr"};
+  return hasExtension(path, extensions);
+}
+
+bool isFont(const std::filesystem::path &path) {
+  static const char *const extensions[] = {".ttf", ".otf", ".ttc"};
+  return hasExtension(path, extensions);
+}
+
+bool isScene(const std::filesystem::path &path) {
+  return path.extension() == ".json";
+}
+
+nlohmann::json loadProjectConfig(const std::filesystem::path &dir) {
+  std::ifstream file(dir / "sakura.json");
+  if (!file.is_open()) {
+    throw std::runtime_error(
+        "sakura.json: no such file, expects project configuration");
+  }
+  nlohmann::json config;
+  file >> config;
+  return config;
+}
+
+std::filesystem::path prefix(const std::filesystem::path &dir,
+                             const nlohmann::json &config,
+                             const std::string &name) {
+  auto prefixes = config.find("prefixes");
+  if (prefixes != config.end() && prefixes->is_object()) {
+    auto it = prefixes->find(name);
+    if (it != prefixes->end() && it->is_string()) {
+      return dir / it->get<std::string>();
+    }
+  }
+  return dir;
+}
+
+enum class Result { COOKED, SKIPPED, HASHED, FAILED };
+
+struct Task {
+  enum Kind { TEXTURE, FONT, SCENE };
+
+  Kind kind;
+  std::filesystem::path source;
+  // file name relative to the prefix, as scripts and scenes refer to it
+  std::string name;
+  std::uint64_t hash = 0;
+  // the engine trusts the hash only while these match the file
+  std::uintmax_t size = 0;
+  std::int64_t time = 0;
+};
+
+// Stats the file before hashing it, so that a change while it is hashed
+// makes the recorded hash look stale rather than current.
+bool hashSource(Task &task) {
+  std::error_code ec;
+  task.size = std::filesystem::file_size(task.source, ec);
+  if (ec) {
+    return false;
+  }
+  task.time =
+      std::filesystem::last_write_time(task.source, ec).time_since_epoch().count();
+  if (ec) {
+    return false;
+  }
+  task.hash = sakura::hashFile(task.source);
+  return task.hash != 0;
+}
+
+Result hashFont(Task &task) {
+  return hashSource(task) ? Result::HASHED : Result::FAILED;
+}
+
+// The engine loads a cooked texture only if it is not older than its source,
+// so the cooked file of a source touched but not changed is touched too
+// rather than cooked again.
+bool touchCooked(const std::filesystem::path &target,
+                 const std::filesystem::path &source) {
+  std::error_code ec;
+  auto source_time = std::filesystem::last_write_time(source, ec);
+  if (ec) {
+    return false;
+  }
+  auto target_time = std::filesystem::last_write_time(target, ec);
+  if (ec) {
+    return false;
+  }
+  if (source_time > target_time) {
+    std::filesystem::last_write_time(target, source_time, ec);
+  }
+  return !ec;
+}
+
+Result cookTexture(Task &task, bool force) {
+  const auto &source = task.source;
+  if (!hashSource(task)) {
+    return Result::FAILED;
+  }
+  auto hash = task.hash;
+  auto target = sakura::cookedTexturePath(source);
+  sakura::CookedTextureHeader header;
+  if (!force && sakura::readCookedTextureHeader(target, header) &&
+      header.source_hash == hash && touchCooked(target, source)) {
+    return Result::SKIPPED;
+  }
+
+  sf::Image image;
+  if (!image.loadFromFile(source.string())) {
+    return Result::FAILED;
+  }
+  auto size = image.getSize();
+  std::vector<std::uint8_t> pixels(image.getPixelsPtr(),
+                                   image.getPixelsPtr() +
+                                       std::size_t{size.x} * size.y * 4);
+  sakura::premultiplyAlpha(pixels.data(), std::size_t{size.x} * size.y);
+
+  header = {};
+  header.flags = sakura::CookedTextureHeader::PREMULTIPLIED_ALPHA;
+  header.width = size.x;
+  header.height = size.y;
+  header.source_hash = hash;
+  return sakura::writeCookedTexture(target, header, pixels.data())
+             ? Result::COOKED
+             : Result::FAILED;
+}
+
+Result compileScene(const std::filesystem::path &source, bool force) {
+  auto target = sakura::compiledScenePath(source);
+  try {
+    std::error_code ec;
+    auto target_time = std::filesystem::last_write_time(target, ec);
+    if (!force && !ec &&
+        std::filesystem::last_write_time(source) <= target_time) {
+      return Result::SKIPPED;
+    }
+
+    std::ifstream file(source);
+    nlohmann::json config;
+    file >> config;
+    auto proto =
+        sakura::SceneProto::compile(config, source.filename().string());
+    std::ofstream output(target, std::ios::binary | std::ios::trunc);
+    return proto.save(output) ? Result::COOKED : Result::FAILED;
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << '\n';
+    return Result::FAILED;
+  }
+}
+
+bool writeManifest(const std::filesystem::path &path,
+                   const std::vector<Task> &tasks) {
+  nlohmann::json manifest;
+  manifest["textures"] = nlohmann::json::object();
+  manifest["fonts"] = nlohmann::json::object();
+  for (auto &task : tasks) {
+    if (task.hash == 0 || task.kind == Task::SCENE) {
+      continue;
+    }
+    auto &entries = manifest[task.kind == Task::TEXTURE ? "textures" : "fonts"];
+    entries[task.name] = {{"hash", fmt::format("{:016x}", task.hash)},
+                          {"size", task.size},
+                          {"time", task.time}};
+  }
+  std::ofstream file(path, std::ios::trunc);
+  file << manifest.dump(2) << '\n';
+  return file.good();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::filesystem::path dir;
+  unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+  bool force = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-j" && i + 1 < argc) {
+      jobs = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--force") {
+      force = true;
+    } else {
+      dir = arg;
+    }
+  }
+  if (dir.empty()) {
+    std::cerr << "usage: sakura-cook [-j <jobs>] [--force] <project dir>\n";
+    return -1;
+  }
+  if (!std::filesystem::is_directory(dir)) {
+    std::cerr << fmt::format("{}: no such directory\n", dir.string());
+    return -1;
+  }
+
+  std::vector<Task> tasks;
+  try {
+    auto config = loadProjectConfig(dir);
+    auto collect = [&](Task::Kind kind, const std::string &name, auto filter) {
+      auto root = prefix(dir, config, name);
+      for (auto &entry : std::filesystem::recursive_directory_iterator(root)) {
+        if (entry.is_regular_file() && filter(entry.path())) {
+          tasks.push_back(
+              {kind, entry.path(),
+               std::filesystem::relative(entry.path(), root).generic_string()});
+        }
+      }
+    };
+    collect(Task::TEXTURE, "texture", isImage);
+    collect(Task::FONT, "font", isFont);
+    collect(Task::SCENE, "scene", [](const std::filesystem::path &path) {
+      return isScene(path) && path.filename() != "sakura.json" &&
+             path.filename() != "manifest.json";
+    });
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << '\n';
+    return -1;
+  }
+
+  std::atomic<std::size_t> next = 0;
+  std::atomic<std::size_t> cooked = 0;
+  std::atomic<std::size_t> skipped = 0;
+  std::atomic<std::size_t> hashed = 0;
+  std::mutex failures_mutex;
+  std::vector<std::filesystem::path> failures;
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < std::min<std::size_t>(jobs, tasks.size()); ++i) {
+    workers.emplace_back([&] {
+      for (auto index = next++; index < tasks.size(); index = next++) {
+        auto &task = tasks[index];
+        Result result = Result::FAILED;
+        switch (task.kind) {
+        case Task::TEXTURE:
+          result = cookTexture(task, force);
+          break;
+        case Task::FONT:
+          result = hashFont(task);
+          break;
+        case Task::SCENE:
+          result = compileScene(task.source, force);
+          break;
+        }
+        switch (result) {
+        case Result::COOKED:
+          ++cooked;
+          break;
+        case Result::SKIPPED:
+          ++skipped;
+          break;
+        case Result::HASHED:
+          ++hashed;
+          break;
+        case Result::FAILED: {
+          std::lock_guard lock(failures_mutex);
+          failures.push_back(task.source);
+          break;
+        }
+        }
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  for (auto &failure : failures) {
+    std::cerr << fmt::format("{}: can't cook file\n", failure.string());
+  }
+  if (!writeManifest(dir / "manifest.json", tasks)) {
+    std::cerr << "manifest.json: can't write manifest file\n";
+    return 1;
+  }
+  std::cout << fmt::format("{} cooked, {} up to date, {} hashed, {} failed\n",
+                           cooked.load(), skipped.load(), hashed.load(),
+                           failures.size());
+  return failures.empty() ? 0 : 1;
+}
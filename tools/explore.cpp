@@ -0,0 +1,584 @@
+// sakura-explore: plays every path through the story of a project without
+// presenting anything. Presentation commands are stubbed, and the state of
+// the script engine is forked wherever the player chooses: at @select, and
+// at the buttons of the current scene whenever the script waits. States are
+// explored once each, on every core, so that reachability, coverage and the
+// number of paths to every ending are known without playing the game.
+//
+// Usage: sakura-explore [-j <jobs>] <project dir>
+
+#include "../sakura/elaina/script_engine.h"
+#include "../sakura/job_system.h"
+#include "../sakura/scene_proto.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using sakura::elaina::ScriptEngine;
+
+// commands run without waiting for the player before giving up
+constexpr std::size_t MAX_STEPS = 1'000'000;
+
+// Where a playthrough waits for the player or enters another script.
+struct State {
+  std::string script;
+  std::size_t position = 0;
+  std::string scene;
+  // sorted by name
+  std::vector<std::pair<std::string, int>> variables;
+
+  std::string key() const {
+    auto key = fmt::format("{}\n{}\n{}\n", script, position, scene);
+    for (auto &[name, value] : variables) {
+      key += fmt::format("{}={};", name, value);
+    }
+    return key;
+  }
+};
+
+struct Node {
+  enum Outcome { BRANCH, ENDING, ERROR };
+
+  Outcome outcome = BRANCH;
+  // where it starts
+  std::string script;
+  std::size_t position = 0;
+  std::vector<std::uint32_t> successors;
+  // the script an ending stops in, or the error
+  std::string detail;
+};
+
+// A script engine whose presentation commands only pop their arguments.
+struct Vm {
+  explicit Vm(const ScriptEngine &master);
+  State state() const;
+
+  ScriptEngine engine;
+  std::string scene;
+  // the actions of the pending @select
+  std::vector<std::string> choices;
+};
+
+Vm::Vm(const ScriptEngine &master) {
+  engine.script_dir_prefix = master.script_dir_prefix;
+  engine.shareScripts(master);
+  auto command = [this](const char *name,
+                        std::function<void(ScriptEngine &)> func) {
+    engine.registerCommand(name, std::move(func));
+  };
+  command("say", [](ScriptEngine &se) {
+    se.popText();
+    se.popText();
+    se.blocked = true;
+  });
+  for (auto name : {"bgm", "voice", "se", "background", "rmSprite"}) {
+    command(name, [](ScriptEngine &se) { se.popString(); });
+  }
+  for (auto name : {"pauseBgm", "stopBgm"}) {
+    command(name, [](ScriptEngine &) {});
+  }
+  command("addSprite", [](ScriptEngine &se) {
+    if (se.argc() > 4) {
+      se.popInt();
+    }
+    se.popInt();
+    se.popInt();
+    se.popString();
+    se.popString();
+  });
+  command("select", [this](ScriptEngine &se) {
+    auto second = se.popString();
+    se.popText();
+    auto first = se.popString();
+    se.popText();
+    choices = {first, second};
+    se.blocked = true;
+  });
+  command("scene", [this](ScriptEngine &se) { scene = se.popString(); });
+}
+
+State Vm::state() const {
+  State state{engine.currentScript(), engine.position(), scene, {}};
+  state.variables.assign(engine.variables.begin(), engine.variables.end());
+  std::sort(state.variables.begin(), state.variables.end());
+  return state;
+}
+
+thread_local std::unique_ptr<Vm> local_vm;
+
+class Explorer {
+public:
+  // `master` has compiled every script, whose commands are counted by
+  // `sizes`.
+  Explorer(sakura::JobSystem &jobs, const ScriptEngine &master,
+           const std::map<std::string, std::size_t> &sizes,
+           std::unordered_map<std::string, std::vector<std::string>> buttons)
+      : jobs_(jobs), master_(master), buttons_(std::move(buttons)) {
+    for (auto &[name, size] : sizes) {
+      coverage_.try_emplace(name, size);
+    }
+  }
+
+  // Blocks until every state reachable from `root` has been explored.
+  void run(State root) {
+    intern(std::move(root));
+    while (auto outstanding = outstanding_.load()) {
+      outstanding_.wait(outstanding);
+    }
+  }
+
+  const std::deque<Node> &nodes() const { return nodes_; }
+
+  // commands run at least once, and in total, by script
+  std::map<std::string, std::pair<std::size_t, std::size_t>> coverage() const {
+    std::map<std::string, std::pair<std::size_t, std::size_t>> result;
+    for (auto &[name, covered] : coverage_) {
+      auto count = std::count_if(covered.begin(), covered.end(),
+                                 [](auto &flag) { return flag.load(); });
+      result[name] = {static_cast<std::size_t>(count), covered.size()};
+    }
+    return result;
+  }
+
+private:
+  static constexpr std::size_t SHARD_COUNT = 64;
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::uint32_t> ids;
+  };
+
+  // The node of `state`, explored on a worker if it is new.
+  std::uint32_t intern(State state) {
+    auto key = state.key();
+    auto &shard = shards_[std::hash<std::string>{}(key) % SHARD_COUNT];
+    std::uint32_t id;
+    Node *node;
+    {
+      std::lock_guard lock(shard.mutex);
+      auto it = shard.ids.find(key);
+      if (it != shard.ids.end()) {
+        return it->second;
+      }
+      std::lock_guard nodes_lock(nodes_mutex_);
+      id = static_cast<std::uint32_t>(nodes_.size());
+      node = &nodes_.emplace_back();
+      node->script = state.script;
+      node->position = state.position;
+      shard.ids.emplace(std::move(key), id);
+    }
+    ++outstanding_;
+    jobs_.submit("explore", sakura::JobSystem::BACKGROUND,
+                 [this, node, state = std::move(state)] {
+                   explore(*node, state);
+                   if (--outstanding_ == 0) {
+                     outstanding_.notify_all();
+                   }
+                 });
+    return id;
+  }
+
+  void cover(const std::string &script, std::size_t position) {
+    auto it = coverage_.find(script);
+    if (it != coverage_.end() && position < it->second.size()) {
+      it->second[position].store(true, std::memory_order_relaxed);
+    }
+  }
+
+  void explore(Node &node, const State &state) {
+    if (local_vm == nullptr) {
+      local_vm = std::make_unique<Vm>(master_);
+    }
+    auto &vm = *local_vm;
+    auto &engine = vm.engine;
+    engine.variables = {state.variables.begin(), state.variables.end()};
+    engine.blocked = false;
+    vm.scene = state.scene;
+    vm.choices.clear();
+
+    try {
+      engine.loadScript(state.script, state.position);
+      const auto *script = &engine.currentScript();
+      std::size_t steps = 0;
+      while (true) {
+        while (engine.runnable()) {
+          if (++steps > MAX_STEPS) {
+            throw std::runtime_error(fmt::format(
+                "{}: runs {} commands without waiting for input",
+                engine.currentScript(), MAX_STEPS));
+          }
+          cover(engine.currentScript(), engine.position());
+          engine.run();
+          // paths joining in another script are explored once from there
+          if (&engine.currentScript() != script) {
+            node.successors.push_back(intern(vm.state()));
+            return;
+          }
+        }
+
+        auto waiting = vm.state();
+        std::vector<State> choices;
+        if (!vm.choices.empty()) {
+          // only the selectors react while selecting
+          for (auto &action : vm.choices) {
+            choices.push_back({action, 0, waiting.scene, waiting.variables});
+          }
+        } else {
+          auto buttons = buttons_.find(vm.scene);
+          if (buttons != buttons_.end()) {
+            for (auto &action : buttons->second) {
+              choices.push_back({action, 0, waiting.scene, waiting.variables});
+            }
+          }
+          if (engine.blocked && choices.empty()) {
+            // the only way on, keep going here
+            engine.blocked = false;
+            continue;
+          }
+          if (engine.blocked) {
+            choices.push_back(std::move(waiting));
+          }
+        }
+        if (choices.empty()) {
+          node.outcome = Node::ENDING;
+          node.detail = engine.currentScript();
+          return;
+        }
+        for (auto &choice : choices) {
+          node.successors.push_back(intern(std::move(choice)));
+        }
+        return;
+      }
+    } catch (const std::exception &err) {
+      node.outcome = Node::ERROR;
+      node.detail = err.what();
+      node.successors.clear();
+      // the arguments of the failed command may still be on its stack
+      local_vm.reset();
+    }
+  }
+
+private:
+  sakura::JobSystem &jobs_;
+  const ScriptEngine &master_;
+  // actions of the buttons of each scene, selectors excluded
+  std::unordered_map<std::string, std::vector<std::string>> buttons_;
+  std::unordered_map<std::string, std::vector<std::atomic<bool>>> coverage_;
+  std::array<Shard, SHARD_COUNT> shards_;
+  std::mutex nodes_mutex_;
+  std::deque<Node> nodes_;
+  std::atomic<std::size_t> outstanding_{0};
+};
+
+nlohmann::json loadProjectConfig(const std::filesystem::path &dir) {
+  std::ifstream file(dir / "sakura.json");
+  if (!file.is_open()) {
+    throw std::runtime_error(
+        "sakura.json: no such file, expects project configuration");
+  }
+  nlohmann::json config;
+  file >> config;
+  return config;
+}
+
+std::filesystem::path prefix(const std::filesystem::path &dir,
+                             const nlohmann::json &config,
+                             const std::string &name) {
+  auto prefixes = config.find("prefixes");
+  if (prefixes != config.end() && prefixes->is_object()) {
+    auto it = prefixes->find(name);
+    if (it != prefixes->end() && it->is_string()) {
+      return dir / it->get<std::string>();
+    }
+  }
+  return dir;
+}
+
+// The actions of the buttons of `file_name` which react outside @select.
+std::vector<std::string> sceneButtons(const std::filesystem::path &scene_dir,
+                                      const std::string &file_name) {
+  std::ifstream file(scene_dir / file_name);
+  if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("{}: can't open scene config file", file_name));
+  }
+  nlohmann::json config;
+  file >> config;
+  auto proto = sakura::SceneProto::compile(config, file_name);
+  std::vector<std::string> actions;
+  for (std::uint32_t i = 0; i < proto.widgets.size(); ++i) {
+    auto &widget = proto.widgets[i];
+    auto &action = widget.actions[sakura::WidgetProto::CLICKED];
+    if (widget.type == sakura::WidgetProto::PUSH_BUTTON &&
+        i != proto.first_selector && i != proto.second_selector &&
+        !action.empty()) {
+      actions.push_back(action);
+    }
+  }
+  return actions;
+}
+
+// The scene files passed to @scene as string literals.
+std::vector<std::string>
+sceneArguments(const std::vector<std::unique_ptr<sakura::elaina::Ast>> &script) {
+  std::vector<std::string> scenes;
+  for (auto &ast : script) {
+    if (ast->type() != sakura::elaina::Ast::COMMAND) {
+      continue;
+    }
+    auto command = dynamic_cast<const sakura::elaina::CommandAst *>(ast.get());
+    if (command->command.value == "scene" && !command->args.empty() &&
+        command->args[0]->type() == sakura::elaina::Ast::STRING) {
+      scenes.push_back(
+          dynamic_cast<const sakura::elaina::StringAst *>(command->args[0].get())
+              ->value);
+    }
+  }
+  return scenes;
+}
+
+std::uint64_t saturatingAdd(std::uint64_t lhs, std::uint64_t rhs) {
+  return lhs > UINT64_MAX - rhs ? UINT64_MAX : lhs + rhs;
+}
+
+struct Analysis {
+  // distinct paths from the root, each cycle taken at most once
+  std::vector<std::uint64_t> paths;
+  std::vector<bool> reaches_ending;
+  std::size_t cycles = 0;
+};
+
+Analysis analyze(const std::deque<Node> &nodes) {
+  Analysis analysis;
+  analysis.paths.assign(nodes.size(), 0);
+  analysis.reaches_ending.assign(nodes.size(), false);
+  if (nodes.empty()) {
+    return analysis;
+  }
+
+  // reverse post-order, in which only the edges closing a cycle go back
+  enum Color : std::uint8_t { WHITE, GRAY, BLACK };
+  std::vector<Color> colors(nodes.size(), WHITE);
+  std::vector<std::uint32_t> order;
+  std::vector<std::pair<std::uint32_t, std::size_t>> stack{{0, 0}};
+  colors[0] = GRAY;
+  while (!stack.empty()) {
+    auto &[id, next] = stack.back();
+    if (next == nodes[id].successors.size()) {
+      colors[id] = BLACK;
+      order.push_back(id);
+      stack.pop_back();
+      continue;
+    }
+    auto successor = nodes[id].successors[next++];
+    if (colors[successor] == WHITE) {
+      colors[successor] = GRAY;
+      stack.emplace_back(successor, 0);
+    } else if (colors[successor] == GRAY) {
+      ++analysis.cycles;
+    }
+  }
+  std::reverse(order.begin(), order.end());
+  std::vector<std::size_t> rank(nodes.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    rank[order[i]] = i;
+  }
+
+  analysis.paths[0] = 1;
+  for (auto id : order) {
+    for (auto successor : nodes[id].successors) {
+      if (rank[successor] > rank[id]) {
+        analysis.paths[successor] =
+            saturatingAdd(analysis.paths[successor], analysis.paths[id]);
+      }
+    }
+  }
+
+  std::vector<std::vector<std::uint32_t>> predecessors(nodes.size());
+  std::vector<std::uint32_t> queue;
+  for (std::uint32_t id = 0; id < nodes.size(); ++id) {
+    for (auto successor : nodes[id].successors) {
+      predecessors[successor].push_back(id);
+    }
+    if (nodes[id].outcome == Node::ENDING) {
+      analysis.reaches_ending[id] = true;
+      queue.push_back(id);
+    }
+  }
+  while (!queue.empty()) {
+    auto id = queue.back();
+    queue.pop_back();
+    for (auto predecessor : predecessors[id]) {
+      if (!analysis.reaches_ending[predecessor]) {
+        analysis.reaches_ending[predecessor] = true;
+        queue.push_back(predecessor);
+      }
+    }
+  }
+  return analysis;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::filesystem::path dir;
+  unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-j" && i + 1 < argc) {
+      jobs = std::max(1, std::stoi(argv[++i]));
+    } else {
+      dir = arg;
+    }
+  }
+  if (dir.empty()) {
+    std::cerr << "usage: sakura-explore [-j <jobs>] <project dir>\n";
+    return -1;
+  }
+  if (!std::filesystem::is_directory(dir)) {
+    std::cerr << fmt::format("{}: no such directory\n", dir.string());
+    return -1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  ScriptEngine master;
+  std::map<std::string, std::size_t> sizes;
+  std::map<std::string, std::string> parse_errors;
+  std::unordered_map<std::string, std::vector<std::string>> buttons;
+  std::map<std::string, std::string> scene_errors;
+  try {
+    auto config = loadProjectConfig(dir);
+    master.script_dir_prefix = prefix(dir, config, "script");
+    std::vector<std::string> names{"entry.ela"};
+    for (auto &entry :
+         std::filesystem::recursive_directory_iterator(master.script_dir_prefix)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".ela") {
+        names.push_back(
+            std::filesystem::relative(entry.path(), master.script_dir_prefix)
+                .generic_string());
+      }
+    }
+    auto scene_dir = prefix(dir, config, "scene");
+    for (auto &name : names) {
+      if (sizes.count(name) != 0 || parse_errors.count(name) != 0) {
+        continue;
+      }
+      try {
+        auto &script = master.compile(name);
+        sizes[name] = script.size();
+        for (auto &scene : sceneArguments(script)) {
+          if (buttons.count(scene) != 0 || scene_errors.count(scene) != 0) {
+            continue;
+          }
+          try {
+            buttons[scene] = sceneButtons(scene_dir, scene);
+          } catch (const std::exception &err) {
+            scene_errors[scene] = err.what();
+          }
+        }
+      } catch (const std::exception &err) {
+        parse_errors[name] = err.what();
+      }
+    }
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << '\n';
+    return -1;
+  }
+
+  sakura::JobSystem job_system(jobs);
+  Explorer explorer(job_system, master, sizes, std::move(buttons));
+  explorer.run({"entry.ela", 0, "", {}});
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  auto &nodes = explorer.nodes();
+  auto analysis = analyze(nodes);
+  struct Ending {
+    std::uint64_t paths = 0;
+    std::size_t states = 0;
+  };
+  std::map<std::string, Ending> endings;
+  std::map<std::string, std::set<std::string>> errors;
+  std::set<std::string> stuck;
+  for (std::uint32_t id = 0; id < nodes.size(); ++id) {
+    auto &node = nodes[id];
+    auto where = fmt::format("{}:{}", node.script, node.position);
+    switch (node.outcome) {
+    case Node::ENDING: {
+      auto &ending = endings[node.detail];
+      ending.paths = saturatingAdd(ending.paths, analysis.paths[id]);
+      ++ending.states;
+      break;
+    }
+    case Node::ERROR:
+      errors[node.detail].insert(where);
+      break;
+    case Node::BRANCH:
+      if (!analysis.reaches_ending[id]) {
+        stuck.insert(where);
+      }
+      break;
+    }
+  }
+
+  auto ending_list = nlohmann::json::array();
+  for (auto &[script, ending] : endings) {
+    ending_list.push_back(
+        {{"script", script}, {"paths", ending.paths}, {"states", ending.states}});
+  }
+  auto error_list = nlohmann::json::array();
+  for (auto &[message, states] : errors) {
+    error_list.push_back({{"message", message}, {"states", states}});
+  }
+  std::size_t covered = 0;
+  std::size_t total = 0;
+  std::vector<std::string> unreachable;
+  auto scripts = nlohmann::json::object();
+  for (auto &[name, counts] : explorer.coverage()) {
+    covered += counts.first;
+    total += counts.second;
+    if (counts.first == 0 && counts.second != 0) {
+      unreachable.push_back(name);
+    }
+    scripts[name] = {counts.first, counts.second};
+  }
+
+  nlohmann::json report{
+      {"states", nodes.size()},
+      {"threads", job_system.workerCount()},
+      {"seconds", elapsed.count()},
+      {"endings", std::move(ending_list)},
+      {"cycles", analysis.cycles},
+      {"errors", std::move(error_list)},
+      {"parse_errors", parse_errors},
+      {"scene_errors", scene_errors},
+      {"stuck", stuck},
+      {"unreachable_scripts", unreachable},
+      {"coverage",
+       {{"commands", covered}, {"total", total}, {"scripts", scripts}}}};
+  std::cout << report.dump(2) << '\n';
+  return errors.empty() && parse_errors.empty() && scene_errors.empty() &&
+                 stuck.empty()
+             ? 0
+             : 1;
+}
@@ -1,10 +1,23 @@
 add_rules("mode.debug", "mode.release")
-add_requires("fmt", "magic_enum", "nlohmann_json", "sfml")
+add_requires("fmt", "freetype", "magic_enum", "nlohmann_json", "sfml")
+
+target("sakura-core")
+    set_kind("static")
+    set_languages("c++20")
+    add_files("sakura/*.cpp", "sakura/elaina/*.cpp")
+    remove_files("sakura/main.cpp")
+    add_packages("fmt", "freetype", "magic_enum", "nlohmann-json", "sfml", {public = true})
+    add_cxxflags("-Wall", "-Wextra")
+
+    if is_plat("windows", "mingw") then
+        add_syslinks("psapi", {public = true})
+    end
 
 target("sakura")
     set_kind("binary")
     set_languages("c++20")
-    add_files("sakura/*.cpp", "sakura/elaina/*.cpp")
+    add_deps("sakura-core")
+    add_files("sakura/main.cpp")
     add_packages("fmt", "magic_enum", "nlohmann-json", "sfml")
     add_cxxflags("-Wall", "-Wextra")
 
@@ -14,3 +27,63 @@ target("sakura")
             add_ldflags("-mwindows")
         end
     end
+
+target("sakura-cook")
+    set_kind("binary")
+    set_languages("c++20")
+    add_deps("sakura-core")
+    add_files("tools/cook.cpp")
+    add_packages("fmt", "nlohmann-json", "sfml")
+    add_cxxflags("-Wall", "-Wextra")
+
+    if is_plat("mingw") then
+        add_ldflags("-static")
+    end
+
+target("sakura-explore")
+    set_kind("binary")
+    set_languages("c++20")
+    add_deps("sakura-core")
+    add_files("tools/explore.cpp")
+    add_packages("fmt", "nlohmann-json", "sfml")
+    add_cxxflags("-Wall", "-Wextra")
+
+    if is_plat("mingw") then
+        add_ldflags("-static")
+    end
+
+target("sakura-bench-idle")
+    set_kind("binary")
+    set_languages("c++20")
+    set_default(false)
+    add_deps("sakura-core")
+    add_files("bench/idle.cpp")
+    add_packages("fmt", "sfml")
+    add_cxxflags("-Wall", "-Wextra")
+
+target("sakura-bench-typewriter")
+    set_kind("binary")
+    set_languages("c++20")
+    set_default(false)
+    add_deps("sakura-core")
+    add_files("bench/typewriter.cpp")
+    add_packages("fmt", "sfml")
+    add_cxxflags("-Wall", "-Wextra")
+
+target("sakura-bench-elaina")
+    set_kind("binary")
+    set_languages("c++20")
+    set_default(false)
+    add_deps("sakura-core")
+    add_files("bench/elaina.cpp")
+    add_packages("fmt", "nlohmann-json", "sfml")
+    add_cxxflags("-Wall", "-Wextra")
+
+target("sakura-bench-assets")
+    set_kind("binary")
+    set_languages("c++20")
+    set_default(false)
+    add_deps("sakura-core")
+    add_files("bench/assets.cpp")
+    add_packages("fmt", "nlohmann-json", "sfml")
+    add_cxxflags("-Wall", "-Wextra")